@@ -0,0 +1,731 @@
+// Benchmark harness for the engine, solver, history and math code. The
+// generic/ and static/ cases compare the table-driven move generator with
+// the compiled per-layout one; wide/ runs the 256-bit engine and diagonal/
+// the eight-direction rule set. tt/ runs the shared transposition table
+// from 1, 8 and 32 threads and reports its counters alongside the timings.
+// solver/reused_memo counts the heap allocations a warmed-up solver makes.
+// input/queue_to_snapshot is the game's handoff of an input event to its
+// game thread and of the resulting snapshot back.
+//
+//   bench [--reps N] [--min-time SEC] [--filter SUBSTR] [--baseline FILE]
+//         [--save FILE] [--threshold PCT] [--render PATH_TO_SAMPLE]
+//
+// Every case is calibrated to run for at least --min-time per repetition and
+// reports ns/op over --reps repetitions as JSON on stdout. With --baseline the
+// medians are compared against a previous run (saved with --save) and cases
+// slower than --threshold percent are flagged; the exit status is 1 if any
+// case regressed.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board_layout.h"
+#include "math_utils.h"
+#include "move_history.h"
+#include "peg_engine.h"
+#include "peg_solver.h"
+#include "playout.h"
+#include "spsc_queue.h"
+#include "transposition_table.h"
+#include "triple_buffer.h"
+
+static volatile uint64_t sink;
+
+// Heap allocations through operator new while counting is on.
+static std::atomic<bool> countingAllocations(false);
+static std::atomic<uint64_t> heapAllocations(0);
+
+void* operator new(std::size_t n) {
+    if (countingAllocations.load(std::memory_order_relaxed)) heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new(std::size_t n, std::align_val_t align) {
+    if (countingAllocations.load(std::memory_order_relaxed)) heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t a = static_cast<std::size_t>(align);
+    void* p = aligned_alloc(a, (std::max<std::size_t>(n, 1) + a - 1) / a * a);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+// GCC takes the frees for mismatches once inlined into a delete expression.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, std::size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+struct BenchCase {
+    std::string name;
+    int reps;       // 0: use --reps
+    // Runs the case for iters operations and returns elapsed seconds.
+    std::function<double(uint64_t)> run;
+    // Optional: extra JSON fields describing the last run, e.g. counters.
+    std::function<std::string()> counters;
+};
+
+struct BenchResult {
+    std::string name;
+    uint64_t iters;
+    std::vector<double> samples;    // ns/op
+    double mean, median, stddev, min, max;
+};
+
+static double seconds(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Positions visited by random games from the given start hole, used as a
+// realistic input mix for the move generation cases.
+template <class Engine>
+static std::vector<typename Engine::Bits> samplePositions(const Engine& e, int start, int count) {
+    std::vector<typename Engine::Bits> out;
+    std::vector<int> moves(e.numJumps());
+    PegRng rng(42);
+    while (static_cast<int>(out.size()) < count) {
+        typename Engine::Bits pegs = e.fullBoard() ^ Engine::bit(start);
+        for (;;) {
+            out.push_back(pegs);
+            int n = e.generateMoves(pegs, &moves[0]);
+            if (n == 0) break;
+            pegs = e.apply(pegs, moves[rng.below(n)]);
+        }
+    }
+    out.resize(count);
+    return out;
+}
+
+static std::vector<BenchCase> engineCases(const PegEngine& e) {
+    std::vector<BenchCase> cases;
+    std::vector<PegBits> positions = samplePositions(e, e.cellIndex(3, 3), 4096);
+
+    BenchCase gen;
+    gen.name = "engine/generate_moves";
+    gen.reps = 0;
+    gen.run = [&e, positions](uint64_t iters) {
+        std::vector<int> moves(e.numJumps());
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += e.generateMoves(positions[i & 4095], &moves[0]);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(gen);
+
+    BenchCase has;
+    has.name = "engine/has_moves";
+    has.reps = 0;
+    has.run = [&e, positions](uint64_t iters) {
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += e.hasMoves(positions[i & 4095]);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(has);
+
+    BenchCase legal;
+    legal.name = "engine/is_legal_click";
+    legal.reps = 0;
+    legal.run = [&e, positions](uint64_t iters) {
+        uint64_t total = 0;
+        int n = e.numJumps();
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) {
+            const PegJump& j = e.jumps()[i % n];
+            int k = e.findJump(e.cellRow(j.from), e.cellCol(j.from), e.cellRow(j.to), e.cellCol(j.to));
+            total += k >= 0 && e.isLegal(positions[i & 4095], k);
+        }
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(legal);
+
+    BenchCase applyUndo;
+    applyUndo.name = "engine/apply_undo";
+    applyUndo.reps = 0;
+    applyUndo.run = [&e](uint64_t iters) {
+        PegBits pegs = e.fullBoard() ^ pegBit(e.cellIndex(3, 3));
+        int n = e.numJumps();
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) {
+            int k = static_cast<int>(i % n);
+            pegs = e.apply(pegs, k);
+            sink = pegs;
+            pegs = e.apply(pegs, k);
+        }
+        double dt = seconds(t0);
+        sink = pegs;
+        return dt;
+    };
+    cases.push_back(applyUndo);
+
+    BenchCase playout;
+    playout.name = "playout/random_game";
+    playout.reps = 0;
+    playout.run = [&e](uint64_t iters) {
+        PlayoutRunner runner(e);
+        PegRng rng(7);
+        PlayoutTally tally;
+        int centre = e.cellIndex(3, 3);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        runner.run(e.fullBoard() ^ pegBit(centre), centre, PLAYOUT_RANDOM, iters, rng, tally);
+        double dt = seconds(t0);
+        sink = tally.wins;
+        return dt;
+    };
+    cases.push_back(playout);
+
+    for (int hole = 0; hole < e.numCells(); hole++) {
+        BenchCase solve;
+        char name[64];
+        snprintf(name, sizeof(name), "solver/single_hole_%d_%d", e.cellRow(hole), e.cellCol(hole));
+        solve.name = name;
+        solve.reps = 3;
+        solve.run = [&e, hole](uint64_t iters) {
+            double total = 0.0;
+            for (uint64_t i = 0; i < iters; i++) {
+                PegSolver solver(e);
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                sink = solver.solve(e.fullBoard() ^ pegBit(hole), hole);
+                total += seconds(t0);
+            }
+            return total;
+        };
+        cases.push_back(solve);
+    }
+    return cases;
+}
+
+// The engine/ cases above go through the English board's compiled kernels;
+// these run the table-driven fallback and the kernels called directly.
+static std::vector<BenchCase> specialisationCases(const BoardLayout& layout) {
+    std::vector<BenchCase> cases;
+    PegEngine generic(layout.rows, layout.cols, layout.valid, layout.grid);
+    std::vector<PegBits> positions = samplePositions(generic, generic.cellIndex(layout.holeRow, layout.holeCol), 4096);
+
+    BenchCase gen;
+    gen.name = "generic/generate_moves";
+    gen.reps = 0;
+    gen.run = [generic, positions](uint64_t iters) {
+        std::vector<int> moves(generic.numJumps());
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += generic.generateMoves(positions[i & 4095], &moves[0]);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(gen);
+
+    BenchCase has;
+    has.name = "generic/has_moves";
+    has.reps = 0;
+    has.run = [generic, positions](uint64_t iters) {
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += generic.hasMoves(positions[i & 4095]);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(has);
+
+    BenchCase inlined;
+    inlined.name = "static/generate_moves";
+    inlined.reps = 0;
+    inlined.run = [positions](uint64_t iters) {
+        int moves[StaticEngine<EnglishLayout>::NUM_JUMPS];
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += StaticEngine<EnglishLayout>::generateMoves(positions[i & 4095], moves);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(inlined);
+
+    BenchCase inlinedHas;
+    inlinedHas.name = "static/has_moves";
+    inlinedHas.reps = 0;
+    inlinedHas.run = [positions](uint64_t iters) {
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += StaticEngine<EnglishLayout>::hasMoves(positions[i & 4095]);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(inlinedHas);
+    return cases;
+}
+
+// Move generation on one layout with the given engine: wide/ runs the
+// 256-bit engine on a board the 64-bit one also covers (for the cost of the
+// wider type alone) and on one only it can hold; diagonal/ runs the eight
+// direction rule set.
+template <class Engine>
+static std::vector<BenchCase> layoutCases(const std::string& prefix, const BoardLayout& layout) {
+    std::vector<BenchCase> cases;
+    Engine engine;
+    layoutEngine(layout, engine);
+    std::vector<typename Engine::Bits> positions = samplePositions(engine, engine.cellIndex(layout.holeRow, layout.holeCol), 4096);
+
+    BenchCase gen;
+    gen.name = prefix + "/generate_moves/" + layout.name;
+    gen.reps = 0;
+    gen.run = [engine, positions](uint64_t iters) {
+        std::vector<int> moves(engine.numJumps());
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += engine.generateMoves(positions[i & 4095], &moves[0]);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(gen);
+
+    BenchCase has;
+    has.name = prefix + "/has_moves/" + layout.name;
+    has.reps = 0;
+    has.run = [engine, positions](uint64_t iters) {
+        uint64_t total = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += engine.hasMoves(positions[i & 4095]);
+        double dt = seconds(t0);
+        sink = total;
+        return dt;
+    };
+    cases.push_back(has);
+    return cases;
+}
+
+// One solver kept across solves, alternating between two targets so that
+// every solve drops the memo and searches afresh, as the game's analysis
+// worker does when the target changes. The first run warms the solver up on
+// every position; after that its arena covers the largest memo and the
+// solves should make no heap allocations at all.
+static BenchCase reusedSolverCase(const PegEngine& e) {
+    struct Shared {
+        PegSolver solver;
+        std::vector<PegBits> positions;
+        bool warm;
+        uint64_t allocations;
+        explicit Shared(const PegEngine& e) : solver(e), warm(false), allocations(0) {}
+    };
+    std::shared_ptr<Shared> shared = std::make_shared<Shared>(e);
+    std::vector<PegBits> sampled = samplePositions(e, e.cellIndex(3, 3), 4096);
+    for (std::size_t i = 0; i < sampled.size() && shared->positions.size() < 256; i++)
+        if (pegCount(sampled[i]) == 18) shared->positions.push_back(sampled[i]);
+    int targets[2] = {e.cellIndex(3, 3), e.cellIndex(2, 3)};
+    BenchCase c;
+    c.name = "solver/reused_memo";
+    c.reps = 0;
+    c.run = [shared, targets](uint64_t iters) {
+        std::size_t n = shared->positions.size();
+        if (!shared->warm) {
+            for (std::size_t i = 0; i < 2 * n; i++) shared->solver.solve(shared->positions[i % n], targets[i & 1]);
+            shared->warm = true;
+        }
+        uint64_t total = 0;
+        heapAllocations.store(0);
+        countingAllocations.store(true);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) total += shared->solver.solve(shared->positions[i % n], targets[i & 1]);
+        double dt = seconds(t0);
+        countingAllocations.store(false);
+        shared->allocations = heapAllocations.load();
+        sink = total;
+        return dt;
+    };
+    c.counters = [shared]() {
+        const Arena& memo = shared->solver.memo();
+        std::ostringstream out;
+        out << "\"heap_allocations\": " << shared->allocations << ", \"memo_peak_bytes\": " << memo.peak() << ", \"memo_reserved_bytes\": " << memo.reserved()
+            << ", \"memo_mallocs\": " << memo.systemAllocations();
+        return out.str();
+    };
+    return c;
+}
+
+// The game's undo/redo history (move_history.h), reserved for the English
+// board as the game reserves it.
+static std::vector<BenchCase> historyCases() {
+    std::vector<BenchCase> cases;
+    BenchCase push;
+    push.name = "history/move_undo_redo";
+    push.reps = 0;
+    push.run = [](uint64_t iters) {
+        MoveHistory<PegBits> history;
+        history.reserve(34);
+        PegBits board = (PegBits(1) << 33) - 1;
+        history.reset(board);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) {
+            // A jump played, undone and redone, then undone again.
+            history.play(board ^ (PegBits(1) << (i % 33)), static_cast<int>(i % 76));
+            history.undo();
+            history.redo();
+            history.undo();
+            board = history.current();
+        }
+        double dt = seconds(t0);
+        sink = history.played().size() + board;
+        return dt;
+    };
+    cases.push_back(push);
+    return cases;
+}
+
+static std::vector<BenchCase> matrixCases() {
+    std::vector<BenchCase> cases;
+    BenchCase mul;
+    mul.name = "matrix/cell_transform";
+    mul.reps = 0;
+    mul.run = [](uint64_t iters) {
+        float acc = 0.0f;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) {
+            Matrix4f trans, scale;
+            trans.InitTranslationTransform(0.25f * (i % 7), -0.25f * (i % 5), 0.0f);
+            scale.InitScaleTransform(0.2f, 0.2f, 1.0f);
+            Matrix4f world = trans * scale;
+            acc += world.m[0][3];
+        }
+        double dt = seconds(t0);
+        sink = static_cast<uint64_t>(acc);
+        return dt;
+    };
+    cases.push_back(mul);
+
+    BenchCase inv;
+    inv.name = "matrix/inverse";
+    inv.reps = 0;
+    inv.run = [](uint64_t iters) {
+        float acc = 0.0f;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) {
+            Matrix4f m;
+            m.InitRotateTransform(static_cast<float>(i % 360), 30.0f, 10.0f);
+            m.m[0][3] = 1.0f;
+            m.Inverse();
+            acc += m.m[0][0];
+        }
+        double dt = seconds(t0);
+        sink = static_cast<uint64_t>(acc);
+        return dt;
+    };
+    cases.push_back(inv);
+    return cases;
+}
+
+// Probes and stores from several threads at once into one table, over
+// positions from random games: every op is a probe, and a miss or every
+// fourth op also stores, as a search does. Each run starts from an empty
+// table.
+static BenchCase tableCase(const std::vector<PegBits>& positions, int threads) {
+    struct Shared {
+        TranspositionTable<PegBits> table;
+        TableStats stats;
+        double occupancy;
+        Shared() : table(std::size_t(8) << 20), occupancy(0.0) {}
+    };
+    std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+    BenchCase c;
+    char name[64];
+    snprintf(name, sizeof(name), "tt/probe_store/%dt", threads);
+    c.name = name;
+    c.reps = 0;
+    c.run = [shared, positions, threads](uint64_t iters) {
+        TranspositionTable<PegBits>& table = shared->table;
+        table.clear();
+        table.resetStats();
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> workers;
+        std::size_t mask = positions.size() - 1;
+        for (int t = 0; t < threads; t++)
+            workers.push_back(std::thread([&, t]() {
+                uint64_t begin = iters * t / threads, end = iters * (t + 1) / threads, found = 0;
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) {}
+                for (uint64_t i = begin; i < end; i++) {
+                    const PegBits& key = positions[(i * 0x9E3779B1ULL) & mask];
+                    int value, depth;
+                    bool hit = table.probe(key, value, depth);
+                    found += hit;
+                    if (!hit || (i & 3) == 0) table.store(key, static_cast<int>(i & 0x3f), static_cast<int>(i % 19));
+                    if ((i & 0xffff) == 0) table.newSearch();
+                }
+                sink = found;
+            }));
+        while (ready.load() < threads) std::this_thread::yield();
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::size_t t = 0; t < workers.size(); t++) workers[t].join();
+        double dt = seconds(t0);
+        shared->stats = table.stats();
+        shared->occupancy = table.occupancy();
+        return dt;
+    };
+    c.counters = [shared]() {
+        const TableStats& t = shared->stats;
+        std::ostringstream out;
+        out << "\"probes\": " << t.probes << ", \"hits\": " << t.hits << ", \"stores\": " << t.stores << ", \"collisions\": " << t.collisions
+            << ", \"contended\": " << t.contended << ", \"occupancy\": " << shared->occupancy << ", \"huge_pages\": " << (shared->table.hugePages() ? "true" : "false");
+        return out.str();
+    };
+    return c;
+}
+
+static std::vector<BenchCase> tableCases(const PegEngine& e) {
+    std::vector<BenchCase> cases;
+    std::vector<PegBits> positions = samplePositions(e, e.cellIndex(3, 3), 1 << 20);
+    static const int THREADS[] = {1, 8, 32};
+    for (int i = 0; i < 3; i++) cases.push_back(tableCase(positions, THREADS[i]));
+    return cases;
+}
+
+// Mirrors MarbleSolitaireGame's game thread: each operation queues an event,
+// wakes the thread waiting on a condition variable, which copies a
+// snapshot of about the game's size and publishes it, and spins on the
+// triple buffer until that snapshot arrives.
+static BenchCase handoffCase() {
+    struct Snapshot {
+        uint64_t seq;
+        uint64_t state[160];
+    };
+    struct Shared {
+        SpscQueue<uint64_t, 256> queue;
+        TripleBuffer<Snapshot> snapshots;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping;
+        uint64_t state[160];
+        Shared() : stopping(false) {
+            for (int i = 0; i < 160; i++) state[i] = i;
+        }
+    };
+    BenchCase c;
+    c.name = "input/queue_to_snapshot";
+    c.reps = 0;
+    c.run = [](uint64_t iters) {
+        std::unique_ptr<Shared> shared(new Shared());
+        Shared& sh = *shared;
+        std::thread game([&sh]() {
+            std::unique_lock<std::mutex> lock(sh.mutex);
+            while (!sh.stopping) {
+                sh.wake.wait_for(lock, std::chrono::milliseconds(10), [&sh] { return sh.stopping || !sh.queue.empty(); });
+                lock.unlock();
+                uint64_t seq = 0, e;
+                while (sh.queue.pop(e)) seq = e;
+                Snapshot& s = sh.snapshots.back();
+                memcpy(s.state, sh.state, sizeof(s.state));
+                s.seq = seq;
+                if (seq) sh.snapshots.publish();
+                lock.lock();
+            }
+        });
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 1; i <= iters; i++) {
+            while (!sh.queue.push(i)) std::this_thread::yield();
+            { std::lock_guard<std::mutex> lock(sh.mutex); }
+            sh.wake.notify_one();
+            while (!sh.snapshots.update() || sh.snapshots.front().seq != i) std::this_thread::yield();
+        }
+        double dt = seconds(t0);
+        {
+            std::lock_guard<std::mutex> lock(sh.mutex);
+            sh.stopping = true;
+        }
+        sh.wake.notify_one();
+        game.join();
+        sink = sh.snapshots.front().state[159];
+        return dt;
+    };
+    return c;
+}
+
+// Runs `sample --bench-frames N`, which renders into a hidden window and
+// prints "render_fps <value>"; the result is converted to ns/frame.
+static BenchCase renderCase(const std::string& sample) {
+    BenchCase render;
+    render.name = "render/frame";
+    render.reps = 0;
+    render.run = [sample](uint64_t iters) {
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd), "%s --bench-frames %llu 2>/dev/null", sample.c_str(), static_cast<unsigned long long>(iters));
+        FILE* p = popen(cmd, "r");
+        if (!p) return -1.0;
+        char line[256];
+        double fps = -1.0;
+        while (fgets(line, sizeof(line), p))
+            if (strncmp(line, "render_fps ", 11) == 0) fps = atof(line + 11);
+        pclose(p);
+        return fps > 0.0 ? iters / fps : -1.0;
+    };
+    return render;
+}
+
+static bool measure(const BenchCase& c, int reps, double minTime, BenchResult& out) {
+    out.name = c.name;
+    uint64_t iters = 1;
+    for (;;) {
+        double dt = c.run(iters);
+        if (dt < 0.0) return false;
+        if (dt >= minTime || iters >= (1ULL << 40)) break;
+        uint64_t next = dt > 0.0 ? static_cast<uint64_t>(iters * minTime * 1.2 / dt) : iters * 10;
+        iters = std::max(iters * 2, std::min(next, iters * 100));
+    }
+    out.iters = iters;
+    int n = c.reps ? std::min(c.reps, reps) : reps;
+    for (int i = 0; i < n; i++) {
+        double dt = c.run(iters);
+        if (dt < 0.0) return false;
+        out.samples.push_back(dt * 1e9 / iters);
+    }
+    std::vector<double> sorted = out.samples;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0, sq = 0.0;
+    for (std::size_t i = 0; i < sorted.size(); i++) sum += sorted[i];
+    out.mean = sum / sorted.size();
+    for (std::size_t i = 0; i < sorted.size(); i++) sq += (sorted[i] - out.mean) * (sorted[i] - out.mean);
+    out.stddev = sorted.size() > 1 ? std::sqrt(sq / (sorted.size() - 1)) : 0.0;
+    out.median = sorted.size() % 2 ? sorted[sorted.size() / 2] : 0.5 * (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]);
+    out.min = sorted.front();
+    out.max = sorted.back();
+    return true;
+}
+
+// Reads name -> median from a file written by --save. Only understands the
+// layout this program emits.
+static std::map<std::string, double> loadBaseline(const char* path) {
+    std::map<std::string, double> medians;
+    std::ifstream f(path);
+    std::string line, name;
+    while (std::getline(f, line)) {
+        std::size_t p = line.find("\"name\": \"");
+        if (p != std::string::npos) {
+            std::size_t start = p + 9;
+            name = line.substr(start, line.find('"', start) - start);
+        }
+        p = line.find("\"median\": ");
+        if (p != std::string::npos && !name.empty()) medians[name] = atof(line.c_str() + p + 10);
+    }
+    return medians;
+}
+
+int main(int argc, char* argv[]) {
+    int reps = 5;
+    double minTime = 0.1;
+    double threshold = 10.0;
+    const char* filter = "";
+    const char* baselinePath = nullptr;
+    const char* savePath = nullptr;
+    const char* sample = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--reps" && more) reps = std::max(1, atoi(argv[++i]));
+        else if (a == "--min-time" && more) minTime = atof(argv[++i]);
+        else if (a == "--filter" && more) filter = argv[++i];
+        else if (a == "--baseline" && more) baselinePath = argv[++i];
+        else if (a == "--save" && more) savePath = argv[++i];
+        else if (a == "--threshold" && more) threshold = atof(argv[++i]);
+        else if (a == "--render" && more) sample = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--reps N] [--min-time SEC] [--filter SUBSTR] [--baseline FILE] [--save FILE] [--threshold PCT] [--render SAMPLE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    PegEngine engine = findLayout("english")->engine();
+    std::vector<BenchCase> cases = engineCases(engine);
+    std::vector<BenchCase> more = specialisationCases(*findLayout("english"));
+    cases.insert(cases.end(), more.begin(), more.end());
+    more = layoutCases<WidePegEngine>("wide", *findLayout("english"));
+    cases.insert(cases.end(), more.begin(), more.end());
+    more = layoutCases<WidePegEngine>("wide", *findLayout("cross11"));
+    cases.insert(cases.end(), more.begin(), more.end());
+    more = layoutCases<PegEngine>("diagonal", withRules(*findLayout("english"), RULES_DIAGONAL));
+    cases.insert(cases.end(), more.begin(), more.end());
+    more = historyCases();
+    cases.insert(cases.end(), more.begin(), more.end());
+    more = matrixCases();
+    cases.insert(cases.end(), more.begin(), more.end());
+    more = tableCases(engine);
+    cases.insert(cases.end(), more.begin(), more.end());
+    cases.push_back(reusedSolverCase(engine));
+    cases.push_back(handoffCase());
+    if (sample) cases.push_back(renderCase(sample));
+
+    std::map<std::string, double> baseline;
+    if (baselinePath) baseline = loadBaseline(baselinePath);
+
+    std::ostringstream json;
+    json << "{\n  \"unit\": \"ns/op\",\n  \"repetitions\": " << reps << ",\n  \"benchmarks\": [";
+    bool first = true;
+    int regressions = 0;
+    for (std::size_t i = 0; i < cases.size(); i++) {
+        if (!strstr(cases[i].name.c_str(), filter)) continue;
+        BenchResult r;
+        if (!measure(cases[i], reps, minTime, r)) {
+            fprintf(stderr, "%-32s skipped\n", cases[i].name.c_str());
+            continue;
+        }
+        json << (first ? "\n" : ",\n") << "    {\n";
+        json << "      \"name\": \"" << r.name << "\",\n";
+        json << "      \"iterations\": " << r.iters << ",\n";
+        json << "      \"mean\": " << r.mean << ",\n";
+        json << "      \"median\": " << r.median << ",\n";
+        json << "      \"stddev\": " << r.stddev << ",\n";
+        json << "      \"min\": " << r.min << ",\n";
+        json << "      \"max\": " << r.max << ",\n";
+        std::string counters = cases[i].counters ? cases[i].counters() : std::string();
+        if (!counters.empty()) json << "      " << counters << ",\n";
+        std::map<std::string, double>::const_iterator b = baseline.find(r.name);
+        if (b != baseline.end() && b->second > 0.0) {
+            double change = 100.0 * (r.median - b->second) / b->second;
+            json << "      \"baseline_median\": " << b->second << ",\n";
+            json << "      \"change_pct\": " << change << ",\n";
+            if (change > threshold) regressions++;
+            fprintf(stderr, "%-32s %12.2f ns/op  %+7.1f%%%s\n", r.name.c_str(), r.median, change, change > threshold ? "  REGRESSION" : "");
+        }
+        else fprintf(stderr, "%-32s %12.2f ns/op\n", r.name.c_str(), r.median);
+        if (!counters.empty()) fprintf(stderr, "%-32s %s\n", "", counters.c_str());
+        json << "      \"samples\": [";
+        for (std::size_t k = 0; k < r.samples.size(); k++) json << (k ? ", " : "") << r.samples[k];
+        json << "]\n    }";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    fputs(json.str().c_str(), stdout);
+    if (savePath) {
+        std::ofstream out(savePath);
+        out << json.str();
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+// Where an allocation was made: the subsystem the allocating thread was in
+// (see AllocScope), or ImGui's own buffers, which reach the tracker through
+// its allocator hooks rather than operator new.
+enum AllocSubsystem {
+    ALLOC_WORKERS,      // background threads: solver, estimator, counter, log
+    ALLOC_FRAME,        // the render thread outside the scopes below
+    ALLOC_INPUT,        // key and mouse handlers
+    ALLOC_GAME,         // the game thread, and board drawing
+    ALLOC_UI,           // building the ImGui windows
+    ALLOC_IMGUI,        // ImGui's internal buffers
+    ALLOC_SUBSYSTEMS
+};
+
+inline const char* allocSubsystemName(int s) {
+    static const char* names[ALLOC_SUBSYSTEMS] = {"workers", "frame", "input", "game", "ui", "imgui"};
+    return names[s];
+}
+
+struct AllocCounts {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+// Heap allocations counted by subsystem while tracking is on. The program's
+// operator new and the ImGui hooks call note(); with tracking off that costs
+// a relaxed load. Frees aren't counted: the point is to find the calls.
+class AllocTracker {
+public:
+    static void setTracking(bool on) { tracking.store(on, std::memory_order_relaxed); }
+    static bool isTracking() { return tracking.load(std::memory_order_relaxed); }
+
+    static void note(std::size_t bytes) { note(current, bytes); }
+    static void note(int subsystem, std::size_t bytes) {
+        if (!tracking.load(std::memory_order_relaxed)) return;
+        counters[subsystem].count.fetch_add(1, std::memory_order_relaxed);
+        counters[subsystem].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    static AllocCounts total(int subsystem) {
+        AllocCounts c = {counters[subsystem].count.load(std::memory_order_relaxed), counters[subsystem].bytes.load(std::memory_order_relaxed)};
+        return c;
+    }
+
+    static int subsystem() { return current; }
+    static void enter(int subsystem) { current = subsystem; }
+
+private:
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> bytes;
+    };
+
+    static inline std::atomic<bool> tracking{false};
+    static inline thread_local int current = ALLOC_WORKERS;
+    static inline Counter counters[ALLOC_SUBSYSTEMS];
+};
+
+// Puts the calling thread in a subsystem until the end of the scope.
+class AllocScope {
+public:
+    explicit AllocScope(AllocSubsystem s) : previous(AllocTracker::subsystem()) { AllocTracker::enter(s); }
+    ~AllocScope() { AllocTracker::enter(previous); }
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+    int previous;
+};
+
+// Turns the running totals into per-frame figures. A frame runs from one
+// endFrame() to the next; it is idle if it involved no input, and in an idle
+// frame of a warmed-up game neither the render thread nor the game thread
+// should allocate. Everything but the workers counts as those two.
+class FrameAllocStats {
+public:
+    static const int HISTORY = 120;
+
+    FrameAllocStats() : frames(0), idle(0), idleAllocating(0), idleAllocs(0) {
+        for (int s = 0; s < ALLOC_SUBSYSTEMS; s++) {
+            seen[s] = AllocTracker::total(s);
+            last[s].count = last[s].bytes = worst[s].count = worst[s].bytes = 0;
+        }
+        for (int i = 0; i < HISTORY; i++) history[i] = 0.0f;
+    }
+
+    void endFrame(bool idleFrame) {
+        uint64_t foreground = 0;
+        for (int s = 0; s < ALLOC_SUBSYSTEMS; s++) {
+            AllocCounts t = AllocTracker::total(s);
+            last[s].count = t.count - seen[s].count;
+            last[s].bytes = t.bytes - seen[s].bytes;
+            seen[s] = t;
+            worst[s].count = std::max(worst[s].count, last[s].count);
+            worst[s].bytes = std::max(worst[s].bytes, last[s].bytes);
+            if (s != ALLOC_WORKERS) foreground += last[s].count;
+        }
+        history[frames % HISTORY] = static_cast<float>(foreground);
+        frames++;
+        if (idleFrame) {
+            idle++;
+            idleAllocating += foreground > 0;
+            idleAllocs += foreground;
+        }
+    }
+
+    const AllocCounts& lastFrame(int s) const { return last[s]; }
+    const AllocCounts& worstFrame(int s) const { return worst[s]; }
+    uint64_t frameCount() const { return frames; }
+    uint64_t idleFrames() const { return idle; }
+    uint64_t idleFramesAllocating() const { return idleAllocating; }
+    uint64_t idleAllocations() const { return idleAllocs; }
+    // Render and game thread allocations of the last HISTORY frames, oldest
+    // at offset.
+    const float* recent() const { return history; }
+    int recentOffset() const { return static_cast<int>(frames % HISTORY); }
+
+private:
+    AllocCounts seen[ALLOC_SUBSYSTEMS], last[ALLOC_SUBSYSTEMS], worst[ALLOC_SUBSYSTEMS];
+    float history[HISTORY];
+    uint64_t frames, idle, idleAllocating, idleAllocs;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "peg_engine.h"
+#include "peg_solver.h"
+#include "win_database.h"
+
+// Single-writer seqlock. The writer bumps the sequence to odd, stores the
+// payload word by word and bumps it back to even; readers retry only while a
+// store is in flight, so they never block on the writer.
+template <class T>
+class SeqlockSnapshot {
+public:
+    SeqlockSnapshot() : seq(0) {
+        T blank;
+        memset(&blank, 0, sizeof(T));
+        store(blank);
+    }
+
+    void store(const T& value) {
+        uint64_t tmp[WORDS];
+        memcpy(tmp, &value, sizeof(T));
+        uint64_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < WORDS; i++) words[i].store(tmp[i], std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t tmp[WORDS];
+        uint64_t before, after;
+        do {
+            before = seq.load(std::memory_order_acquire);
+            for (int i = 0; i < WORDS; i++) tmp[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        T value;
+        memcpy(&value, tmp, sizeof(T));
+        return value;
+    }
+
+private:
+    static const int WORDS = (sizeof(T) + 7) / 8;
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[WORDS];
+};
+
+// Runs the solver on a worker thread against the most recently requested
+// position. A new request cancels the running solve; results and progress
+// are published through a seqlock so the render loop never waits. Every
+// position along a winning line is cached with its next jump, so following a
+// hint or undoing back onto a solved line is answered without searching, as
+// is any position found in the winnability database, if one is given.
+template <class Engine>
+class BasicAnalysisService {
+public:
+    typedef typename Engine::Bits Bits;
+
+    struct Result {
+        uint64_t generation;    // request this result belongs to
+        uint64_t nodes;
+        uint64_t memoPeak;      // most bytes the solver's memo has held
+        int32_t status;         // SolveStatus
+        int32_t bestMove;       // jump index, -1 if none
+        int32_t done;
+        int32_t pad;
+    };
+
+    static const std::size_t MAX_CACHED_MOVES = 1 << 20;
+
+    BasicAnalysisService() : engine(nullptr), database(nullptr), memo(nullptr), latest(0), pegs(0), target(-1), stopping(false) {}
+    ~BasicAnalysisService() { stop(); }
+
+    // db, if given, must stay open until stop(). A request made before the
+    // previous stop() belongs to the old engine and is dropped.
+    void start(const Engine* e, const BasicWinDatabase<Engine>* db = nullptr) {
+        stop();
+        engine = e;
+        database = db;
+        stopping = false;
+        target = -1;
+        worker = std::thread(&BasicAnalysisService::workerLoop, this, latest.load(std::memory_order_relaxed));
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Returns the generation number the result of this request will carry.
+    uint64_t request(Bits position, int targetCell) {
+        uint64_t gen;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pegs = position;
+            target = targetCell;
+            gen = latest.load(std::memory_order_relaxed) + 1;
+            latest.store(gen, std::memory_order_relaxed);
+        }
+        wake.notify_all();
+        return gen;
+    }
+
+    // Latest published result. Callers should ignore it when
+    // result.generation != generation().
+    Result snapshot() const { return published.load(); }
+    uint64_t generation() const { return latest.load(std::memory_order_relaxed); }
+
+private:
+    // done: the generation already answered, or dropped by start().
+    void workerLoop(uint64_t done) {
+        BasicPegSolver<Engine> solver(*engine);
+        memo = &solver.memo();
+        std::unordered_map<Bits, int> winningMoves;
+        int cachedTarget = -1;
+        for (;;) {
+            Bits position;
+            int cell;
+            uint64_t gen;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || latest.load(std::memory_order_relaxed) != done; });
+                if (stopping) return;
+                position = pegs;
+                cell = target;
+                gen = latest.load(std::memory_order_relaxed);
+            }
+            if (cell != cachedTarget) {
+                winningMoves.clear();
+                cachedTarget = cell;
+            }
+            typename std::unordered_map<Bits, int>::const_iterator hit = winningMoves.find(position);
+            if (hit != winningMoves.end()) {
+                done = gen;
+                publish(gen, 0, SOLVE_WINNABLE, hit->second, true);
+                continue;
+            }
+            SolveStatus known = database && database->covers(cell) ? database->lookup(position) : SOLVE_UNKNOWN;
+            if (known != SOLVE_UNKNOWN) {
+                done = gen;
+                publish(gen, 0, known, known == SOLVE_WINNABLE ? database->winningMove(position) : -1, true);
+                continue;
+            }
+            publish(gen, 0, SOLVE_UNKNOWN, -1, false);
+            SolveStatus status = solver.solve(position, cell, [&](uint64_t nodes) {
+                if (latest.load(std::memory_order_relaxed) != gen) return false;
+                if ((nodes % (BasicPegSolver<Engine>::PROGRESS_INTERVAL * 64)) == 0) publish(gen, nodes, SOLVE_UNKNOWN, -1, false);
+                return true;
+            });
+            done = gen;
+            if (status == SOLVE_UNKNOWN) continue;
+            if (status == SOLVE_WINNABLE) {
+                if (winningMoves.size() >= MAX_CACHED_MOVES) winningMoves.clear();
+                Bits p = position;
+                for (std::size_t i = 0; i < solver.solution().size(); i++) {
+                    int m = solver.solution()[i];
+                    winningMoves[p] = m;
+                    p = engine->apply(p, m);
+                }
+            }
+            publish(gen, solver.nodes(), status, solver.bestMove(), true);
+        }
+    }
+
+    void publish(uint64_t gen, uint64_t nodes, SolveStatus status, int bestMove, bool done) {
+        Result r;
+        r.generation = gen;
+        r.nodes = nodes;
+        r.status = status;
+        r.memoPeak = memo->peak();
+        r.bestMove = bestMove;
+        r.done = done;
+        r.pad = 0;
+        published.store(r);
+    }
+
+    const Engine* engine;
+    const BasicWinDatabase<Engine>* database;
+    const Arena* memo;      // the worker's solver's, for publish()
+    std::atomic<uint64_t> latest;
+    Bits pegs;
+    int target;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    SeqlockSnapshot<Result> published;
+};
+
+typedef BasicAnalysisService<PegEngine> AnalysisService;
+
+#endif
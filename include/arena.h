@@ -0,0 +1,133 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+// Bump allocator for memory that is all let go at once: allocation moves a
+// pointer through the current chunk, freeing a single block does nothing,
+// and reset() frees everything. Chunks come from malloc, each twice the size
+// of the last; a reset that finds more than one replaces them with a single
+// chunk as large as all of them, so once an arena has seen its largest use,
+// filling it again calls malloc no more.
+//
+// An arena belongs to one thread. Each solver owns its own and solvers are
+// never shared between threads, so there is no locking.
+class Arena {
+public:
+    static const std::size_t CHUNK_BYTES = std::size_t(64) << 10;
+
+    explicit Arena(std::size_t firstChunk = CHUNK_BYTES)
+        : chunks(nullptr), at(nullptr), end(nullptr), firstBytes(firstChunk), done(0), peakBytes(0), reservedBytes(0), mallocs(0) {}
+    ~Arena() { release(); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // align is a power of two.
+    void* allocate(std::size_t bytes, std::size_t align) {
+        char* p = alignUp(at, align);
+        if (!p || p + bytes > end) {
+            grow(bytes + align);
+            p = alignUp(at, align);
+        }
+        at = p + bytes;
+        peakBytes = std::max(peakBytes, used());
+        return p;
+    }
+
+    // Frees everything allocated so far.
+    void reset() {
+        if (chunks && chunks->next) {
+            std::size_t total = reservedBytes;
+            release();
+            grow(total - sizeof(Chunk));
+        }
+        done = 0;
+        at = chunks ? reinterpret_cast<char*>(chunks + 1) : nullptr;
+    }
+
+    // Bytes handed out since the last reset, alignment included.
+    std::size_t used() const { return chunks ? done + (at - reinterpret_cast<const char*>(chunks + 1)) : 0; }
+    std::size_t peak() const { return peakBytes; }
+    std::size_t reserved() const { return reservedBytes; }
+    uint64_t systemAllocations() const { return mallocs; }
+
+private:
+    struct Chunk {
+        Chunk* next;
+        std::size_t bytes;      // header included
+    };
+
+    static char* alignUp(char* p, std::size_t align) {
+        return p ? reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + align - 1) & ~uintptr_t(align - 1)) : nullptr;
+    }
+
+    void grow(std::size_t atLeast) {
+        std::size_t bytes = std::max(chunks ? 2 * chunks->bytes : firstBytes, atLeast + sizeof(Chunk));
+        Chunk* c = static_cast<Chunk*>(malloc(bytes));
+        if (!c) {
+            fprintf(stderr, "Error allocating %zu bytes for an arena\n", bytes);
+            abort();
+        }
+        if (chunks) done += at - reinterpret_cast<char*>(chunks + 1);
+        c->next = chunks;
+        c->bytes = bytes;
+        chunks = c;
+        at = reinterpret_cast<char*>(c + 1);
+        end = reinterpret_cast<char*>(c) + bytes;
+        reservedBytes += bytes;
+        mallocs++;
+    }
+
+    void release() {
+        while (chunks) {
+            Chunk* next = chunks->next;
+            free(chunks);
+            chunks = next;
+        }
+        at = end = nullptr;
+        done = reservedBytes = 0;
+    }
+
+    Chunk* chunks;          // newest first
+    char* at;
+    char* end;
+    std::size_t firstBytes;
+    std::size_t done;       // bytes used in chunks before the current one
+    std::size_t peakBytes;
+    std::size_t reservedBytes;
+    uint64_t mallocs;
+};
+
+// Standard allocator drawing from an arena, for containers whose whole
+// contents go at once. A container using one must be destroyed before the
+// arena is reset.
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    explicit ArenaAllocator(Arena* a) : arena(a) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& o) : arena(o.arena) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, std::size_t) {}
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& o) const { return arena == o.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& o) const { return arena != o.arena; }
+
+    Arena* arena;
+};
+
+#endif
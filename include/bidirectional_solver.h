@@ -0,0 +1,349 @@
+#ifndef BIDIRECTIONAL_SOLVER_H
+#define BIDIRECTIONAL_SOLVER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "peg_engine.h"
+#include "peg_solver.h"
+#include "position_file.h"
+
+// Decides whether a position can be played down to a single peg on a target
+// cell by searching from both ends: forward from the start and backward from
+// the goal (the one position with a single peg on the target), a peg count at
+// a time, always moving whichever frontier is smaller, until both hold the
+// same peg count. The position is winnable exactly when those two layers
+// share a position.
+//
+// It expands whole layers, so it is no quicker than BasicPegSolver's
+// depth-first search, which stops at the first win. Measured on English on
+// one core (expanded positions against PegSolver's nodes): the centre game
+// 9.9M against 27K (17 s, PegSolver instantly), centre to (0,3) 26.7M against
+// 37M (33 s against 9 s) and centre to (3,0) 26.7M against 129M (32 s against
+// 29 s); from (2,3) 48M against 0.8M and from (0,2) 85M against 22M (105 s
+// against 3 s). What it offers is a bound on memory and a running time that
+// doesn't depend on move ordering.
+//
+// Every layer is a file of sorted canonical positions under the spill
+// directory, streamed once to expand it and once more to recover a winning
+// line, and removed when solve() returns. Expanding collects the children in
+// memory up to the budget and sorts them into runs on disk past it, which
+// are then merged into the next layer, so a layer of any size fits; the
+// frontiers meet where a streaming pass over both finds a common position.
+//
+// With checkpoints on, layers are written durably and a state file naming
+// the two frontiers joins them every interval, and the spill directory is
+// kept until the search finishes, so a later solve of the same problem with
+// resume picks up at the last checkpoint. A spill directory belongs to one
+// search at a time.
+template <class Engine>
+class BasicBidirectionalSolver {
+public:
+    typedef typename Engine::Bits Bits;
+
+    // Called every PROGRESS_INTERVAL positions expanded with the peg count of
+    // the layer being built and the count so far; returning false abandons
+    // the search.
+    typedef std::function<bool(int, uint64_t)> Progress;
+    static const uint64_t PROGRESS_INTERVAL = 1 << 16;
+    static const std::size_t MEMORY_BYTES = std::size_t(512) << 20;
+
+    BasicBidirectionalSolver(const Engine& e, const std::string& dir = ".", std::size_t memoryBytes = MEMORY_BYTES)
+        : engine(e), spillDir(dir), maxPositions(memoryBytes / sizeof(Bits)), target(-1), expanded(0), peak(0), spilled(0),
+          aborted(false), resuming(false) {
+        BasicPegSolver<Engine>::classMasks(e, classMask);
+    }
+
+    // Checkpoints every interval seconds; with resume, solve() first looks in
+    // the spill directory for a checkpoint of the same problem.
+    void setCheckpoint(double intervalSeconds, bool resume) {
+        clock = CheckpointClock(intervalSeconds);
+        resuming = resume;
+    }
+
+    uint64_t checkpoints() const { return clock.checkpoints(); }
+    double checkpointSeconds() const { return clock.totalSeconds(); }
+
+    // SOLVE_UNKNOWN if cancelled (cancelled()) or on a file error.
+    SolveStatus solve(Bits pegs, int targetCell, const Progress& progress = Progress()) {
+        onProgress = progress;
+        target = targetCell;
+        expanded = peak = spilled = 0;
+        aborted = false;
+        line.clear();
+        stabilizer.clear();
+        for (int s = 1; s < engine.numSymmetries(); s++)
+            if (engine.symmetryCell(s, target) == target) stabilizer.push_back(s);
+        int top = pegCount(pegs);
+        if (top == 0 || target < 0) return SOLVE_LOST;
+        typedef BasicPegSolver<Engine> Solver;
+        if (Solver::positionClass(pegs, classMask) != Solver::positionClass(Engine::bit(target), classMask)) return SOLVE_LOST;
+        SolveStatus status = search(pegs, top);
+        if (status != SOLVE_UNKNOWN || !clock.enabled()) {
+            for (int n = 1; n <= top; n++)
+                for (int side = 0; side < 2; side++) unlink(path(side, n).c_str());
+            unlink(statePath().c_str());
+        }
+        return status;
+    }
+
+    // Jump indices of the winning line found by the last solve().
+    const std::vector<int>& solution() const { return line; }
+    uint64_t expandedCount() const { return expanded; }
+    // Most positions held in memory at once, and positions written to disk.
+    std::size_t peakPositions() const { return peak; }
+    uint64_t spilledPositions() const { return spilled; }
+    bool cancelled() const { return aborted; }
+
+    Bits canonical(Bits pegs) const {
+        Bits best = pegs;
+        for (std::size_t i = 0; i < stabilizer.size(); i++) {
+            Bits p = engine.transform(pegs, stabilizer[i]);
+            if (p < best) best = p;
+        }
+        return best;
+    }
+
+private:
+    static const std::size_t COMPACT = 1 << 22;  // unsorted children before a sort pass
+
+    static std::size_t compact(std::vector<Bits>& out, std::size_t sorted) {
+        std::sort(out.begin() + sorted, out.end());
+        std::inplace_merge(out.begin(), out.begin() + sorted, out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out.size();
+    }
+
+    // The canonical positions one jump after pegs, or one jump before going
+    // backward (a jump can be undone exactly when it could be played on the
+    // complement), sorted and unique.
+    void neighbours(Bits pegs, bool backward, std::vector<Bits>& out) const {
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        int n = engine.generateMoves(backward ? engine.fullBoard() ^ pegs : pegs, moves);
+        out.clear();
+        for (int k = 0; k < n; k++) out.push_back(canonical(pegs ^ engine.jumps()[moves[k]].flip));
+        compact(out, 0);
+    }
+
+    // Writes to file the neighbours of the layer in from, returning how many
+    // there are in size; false if cancelled or on a file error. Children
+    // collect in memory, and whenever they outgrow the budget they are
+    // written as a sorted run, so a layer of any size is the merge of its
+    // runs.
+    bool expand(const std::string& from, bool backward, int pegs, const std::string& file, uint64_t& size) {
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        PositionReader<Bits> r;
+        if (!r.open(from)) {
+            fprintf(stderr, "Error reading layer: '%s'\n", from.c_str());
+            return false;
+        }
+        std::vector<Bits> out;
+        std::vector<std::string> runs;
+        std::size_t sorted = 0;
+        bool ok = true;
+        Bits p;
+        while (ok && r.next(p)) {
+            int n = engine.generateMoves(backward ? engine.fullBoard() ^ p : p, moves);
+            for (int k = 0; k < n; k++) out.push_back(canonical(p ^ engine.jumps()[moves[k]].flip));
+            if (out.size() - sorted > COMPACT || out.size() + engine.numJumps() > maxPositions) {
+                sorted = compact(out, sorted);
+                peak = std::max(peak, out.size());
+                if (out.size() + engine.numJumps() > maxPositions / 2) {
+                    runs.push_back(runPath(runs.size()));
+                    ok = writeRun(out, runs.back(), false);
+                    sorted = 0;
+                }
+            }
+            if ((++expanded % PROGRESS_INTERVAL) == 0 && onProgress && !onProgress(pegs, expanded)) aborted = true;
+            if (aborted) ok = false;
+        }
+        if (r.failed()) {
+            fprintf(stderr, "Error reading layer: '%s'\n", from.c_str());
+            ok = false;
+        }
+        compact(out, sorted);
+        peak = std::max(peak, out.size());
+        PositionWriter<Bits> w;
+        if (ok && runs.empty()) {
+            ok = w.open(file);
+            for (std::size_t i = 0; ok && i < out.size(); i++) w.put(out[i]);
+        }
+        else if (ok) {
+            runs.push_back(runPath(runs.size()));
+            ok = writeRun(out, runs.back(), false) && w.open(file) && mergeRuns(runs, static_cast<PositionReader<Bits>*>(nullptr), w);
+        }
+        std::vector<Bits>().swap(out);
+        for (std::size_t i = 0; i < runs.size(); i++) unlink(runs[i].c_str());
+        size = w.size();
+        spilled += size;
+        return ok && w.commit(clock.enabled());
+    }
+
+    // Layers by peg count, from the start and from the goal.
+    enum FileKind {FORWARD_LAYER, BACKWARD_LAYER};
+
+    std::string path(int kind, int pegs) const {
+        static const char* const names[] = {"f", "b"};
+        char name[48];
+        snprintf(name, sizeof(name), "/meet-%s%03d.bin", names[kind], pegs);
+        return spillDir + name;
+    }
+
+    std::string runPath(std::size_t k) const {
+        char name[48];
+        snprintf(name, sizeof(name), "/meet-run-%06zu.bin", k);
+        return spillDir + name;
+    }
+
+    std::string statePath() const { return spillDir + "/meet.state"; }
+
+    // Layers are only durable when a checkpoint may count on them.
+    bool write(Bits pegs, const std::string& file) {
+        PositionWriter<Bits> w;
+        if (!w.open(file)) return false;
+        w.put(pegs);
+        spilled++;
+        return w.commit(clock.enabled());
+    }
+
+    std::string startText(Bits pegs) const {
+        std::string text(engine.numCells(), '0');
+        for (int i = 0; i < engine.numCells(); i++)
+            if (pegs & Engine::bit(i)) text[i] = '1';
+        return text;
+    }
+
+    // The frontiers are the layers named by the peg counts in the state,
+    // written durably before it.
+    bool saveCheckpoint(Bits pegs, int high, int low) {
+        clock.begin();
+        CheckpointState c;
+        c.set("start", startText(pegs));
+        c.setInt("target", target);
+        c.setInt("high", high);
+        c.setInt("low", low);
+        c.setInt("expanded", static_cast<int64_t>(expanded));
+        c.setInt("spilled", static_cast<int64_t>(spilled));
+        clock.store(c);
+        bool ok = c.save(statePath());
+        clock.end();
+        if (!ok) fprintf(stderr, "Error writing checkpoint in '%s'\n", spillDir.c_str());
+        return ok;
+    }
+
+    bool loadCheckpoint(Bits pegs, int& high, int& low, uint64_t& forward, uint64_t& backward) {
+        resuming = false;
+        CheckpointState c;
+        if (!c.load(statePath()) || c.get("start") != startText(pegs) || c.getInt("target", -1) != target) return false;
+        int h = static_cast<int>(c.getInt("high")), l = static_cast<int>(c.getInt("low"));
+        PositionReader<Bits> f, b;
+        if (!f.open(path(FORWARD_LAYER, h)) || !b.open(path(BACKWARD_LAYER, l))) return false;
+        for (std::size_t k = 0; unlink(runPath(k).c_str()) == 0; k++) {}     // the runs of a layer cut short
+        high = h;
+        low = l;
+        forward = f.size();
+        backward = b.size();
+        expanded = c.getInt("expanded");
+        spilled = c.getInt("spilled");
+        clock.restore(c);
+        return true;
+    }
+
+    // Smallest position in both of two layers, streaming each once:
+    // SOLVE_LOST if they share none, SOLVE_UNKNOWN on a read error.
+    SolveStatus meetIn(const std::string& a, const std::string& b, Bits& found) const {
+        PositionReader<Bits> x, y;
+        if (!x.open(a) || !y.open(b)) return SOLVE_UNKNOWN;
+        Bits p, q;
+        bool more = x.next(p) && y.next(q);
+        while (more && p != q) more = p < q ? x.next(p) : y.next(q);
+        if (x.failed() || y.failed()) return SOLVE_UNKNOWN;
+        if (!more) return SOLVE_LOST;
+        found = p;
+        return SOLVE_WINNABLE;
+    }
+
+    // First of the sorted candidates found in a spilled layer, streaming the
+    // file once; false if none is.
+    bool findIn(const std::string& file, const std::vector<Bits>& candidates, Bits& found) const {
+        PositionReader<Bits> r;
+        if (!r.open(file)) return false;
+        std::size_t i = 0;
+        while (i < candidates.size() && r.next(found)) {
+            while (i < candidates.size() && candidates[i] < found) i++;
+            if (i < candidates.size() && candidates[i] == found) return true;
+        }
+        return false;
+    }
+
+    SolveStatus search(Bits pegs, int top) {
+        // The forward layer with high pegs holds the positions reachable from
+        // the start, the backward one with low pegs those that reach the
+        // goal; forward and backward count them.
+        uint64_t forward = 1, backward = 1;
+        int high = top, low = 1;
+        if (!resuming || !loadCheckpoint(pegs, high, low, forward, backward)) {
+            if (!write(canonical(pegs), path(FORWARD_LAYER, top)) || !write(canonical(Engine::bit(target)), path(BACKWARD_LAYER, 1)))
+                return SOLVE_UNKNOWN;
+        }
+        while (low < high) {
+            bool down = forward <= backward;
+            int kind = down ? FORWARD_LAYER : BACKWARD_LAYER, n = down ? high : low, next = down ? n - 1 : n + 1;
+            if (!expand(path(kind, n), !down, next, path(kind, next), down ? forward : backward)) return SOLVE_UNKNOWN;
+            if ((down ? forward : backward) == 0) return SOLVE_LOST;
+            if (down) high--;
+            else low++;
+            if (low < high && clock.due() && !saveCheckpoint(pegs, high, low)) return SOLVE_UNKNOWN;
+        }
+        Bits meeting = 0;
+        SolveStatus met = meetIn(path(FORWARD_LAYER, low), path(BACKWARD_LAYER, low), meeting);
+        if (met != SOLVE_WINNABLE) return met;
+
+        // A chain of canonical positions through the meeting point, then the
+        // jumps that follow it from the actual start.
+        std::vector<Bits> chain(top + 1), candidates;
+        chain[low] = meeting;
+        for (int n = low + 1; n <= top; n++) {
+            neighbours(chain[n - 1], true, candidates);
+            if (!findIn(path(FORWARD_LAYER, n), candidates, chain[n])) return SOLVE_UNKNOWN;
+        }
+        for (int n = low - 1; n >= 1; n--) {
+            neighbours(chain[n + 1], false, candidates);
+            if (!findIn(path(BACKWARD_LAYER, n), candidates, chain[n])) return SOLVE_UNKNOWN;
+        }
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        for (int n = top; n > 1; n--) {
+            int count = engine.generateMoves(pegs, moves), k = 0;
+            while (k < count && canonical(pegs ^ engine.jumps()[moves[k]].flip) != chain[n - 1]) k++;
+            line.push_back(moves[k]);
+            pegs ^= engine.jumps()[moves[k]].flip;
+        }
+        return SOLVE_WINNABLE;
+    }
+
+    const Engine& engine;
+    std::string spillDir;
+    std::size_t maxPositions;       // children in memory at once
+    int target;
+    uint64_t expanded;
+    std::size_t peak;
+    uint64_t spilled;
+    bool aborted;
+    Progress onProgress;
+    CheckpointClock clock;
+    bool resuming;
+    std::vector<int> stabilizer;    // symmetries other than the identity that fix target
+    std::vector<int> line;
+    Bits classMask[2][3];           // see BasicPegSolver::positionClass()
+};
+
+typedef BasicBidirectionalSolver<PegEngine> BidirectionalSolver;
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef BOARD_LAYOUT_H
+#define BOARD_LAYOUT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "peg_engine.h"
+#include "static_engine.h"
+
+enum BoardType {
+    BOARD_ENGLISH = 0,
+    BOARD_EUROPEAN,
+    BOARD_WIEGLEB,
+    BOARD_DIAMOND,
+    BOARD_ASYMMETRIC,
+    BOARD_CROSS9,
+    BOARD_CROSS11,
+    BOARD_RECTANGLE,
+    BOARD_TRIANGLE15,
+    BOARD_TRIANGLE21,
+    BOARD_HEXAGON37,
+    BOARD_DIAGONAL = 0x80,  // flag on a standard type: played with RULES_DIAGONAL
+    BOARD_CUSTOM = 255      // loaded from a layout file
+};
+
+// A board shape as data. The engine built from it supplies the dense cell
+// index, the jump table and the symmetry group.
+struct BoardLayout {
+    std::string name;
+    uint8_t type;           // BoardType, with BOARD_DIAGONAL under diagonal rules
+    uint8_t grid;           // BoardGrid
+    uint8_t rules;          // JumpRules
+    int rows, cols;
+    std::vector<bool> valid;    // rows * cols, row-major
+    int holeRow, holeCol;   // default starting hole
+    int targetRow, targetCol;   // where the last peg should finish
+
+    int numCells() const {
+        int n = 0;
+        for (std::size_t i = 0; i < valid.size(); i++) n += valid[i];
+        return n;
+    }
+
+    // Standard layouts get their compiled move generation kernels.
+    PegEngine engine() const {
+        PegEngine e(rows, cols, valid, grid, rules);
+        useStaticKernels(e);
+        return e;
+    }
+
+    // Needed for layouts of more than PegEngine::MAX_CELLS cells.
+    WidePegEngine wideEngine() const { return WidePegEngine(rows, cols, valid, grid, rules); }
+};
+
+// Lets code templated on the engine type build the right one.
+inline void layoutEngine(const BoardLayout& l, PegEngine& e) { e = l.engine(); }
+inline void layoutEngine(const BoardLayout& l, WidePegEngine& e) { e = l.wideEngine(); }
+
+// Layout text: one line per row, 'o' for a hole, '*' for the default starting
+// hole, '@' for a target hole other than the starting one and any other
+// character for no hole. Without a '*' the hole nearest the centre of the
+// grid is used. On the hex grid row r is shifted half a hole left per row.
+inline bool parseLayout(const std::string& name, uint8_t type, int grid, const std::vector<std::string>& lines, BoardLayout& out) {
+    out.name = name;
+    out.type = type;
+    out.grid = static_cast<uint8_t>(grid);
+    out.rules = RULES_ORTHOGONAL;
+    out.rows = static_cast<int>(lines.size());
+    out.cols = 0;
+    for (std::size_t r = 0; r < lines.size(); r++)
+        if (static_cast<int>(lines[r].size()) > out.cols) out.cols = static_cast<int>(lines[r].size());
+    out.valid.assign(out.rows * out.cols, false);
+    out.holeRow = out.holeCol = out.targetRow = out.targetCol = -1;
+    int best = -1;
+    for (int r = 0; r < out.rows; r++)
+        for (int c = 0; c < static_cast<int>(lines[r].size()); c++) {
+            char ch = lines[r][c];
+            if (ch != 'o' && ch != '*' && ch != '@') continue;
+            out.valid[r * out.cols + c] = true;
+            if (ch == '@') {
+                out.targetRow = r;
+                out.targetCol = c;
+            }
+            int x = grid == GRID_HEX ? 2 * c - r : 2 * c;
+            int d = ch == '*' ? 0 : 1 + std::abs(2 * r - (out.rows - 1)) + std::abs(x - (out.cols - 1));
+            if (ch != '@' && (best < 0 || d < best)) {
+                best = d;
+                out.holeRow = r;
+                out.holeCol = c;
+            }
+        }
+    if (out.targetRow < 0) {
+        out.targetRow = out.holeRow;
+        out.targetCol = out.holeCol;
+    }
+    int n = out.numCells();
+    if (n < 2 || n > WidePegEngine::MAX_CELLS) {
+        fprintf(stderr, "Layout '%s' has %d holes (need 2..%d)\n", name.c_str(), n, WidePegEngine::MAX_CELLS);
+        return false;
+    }
+    return true;
+}
+
+struct StandardLayouts {
+    std::vector<BoardLayout> layouts;
+
+    StandardLayouts() {
+        add<EnglishLayout>("english", BOARD_ENGLISH);
+        add<EuropeanLayout>("european", BOARD_EUROPEAN);
+        add<WieglebLayout>("wiegleb", BOARD_WIEGLEB);
+        add<DiamondLayout>("diamond", BOARD_DIAMOND);
+        add<AsymmetricLayout>("asymmetric", BOARD_ASYMMETRIC);
+        add<Cross9Layout>("cross9", BOARD_CROSS9);
+        add<Cross11Layout>("cross11", BOARD_CROSS11);
+        add<RectangleLayout>("rectangle", BOARD_RECTANGLE);
+        add<Triangle15Layout>("triangle15", BOARD_TRIANGLE15);
+        add<Triangle21Layout>("triangle21", BOARD_TRIANGLE21);
+        add<Hexagon37Layout>("hexagon37", BOARD_HEXAGON37);
+    }
+
+    template<class L>
+    void add(const char* name, BoardType type) {
+        BoardLayout l;
+        parseLayout(name, static_cast<uint8_t>(type), L::GRID, std::vector<std::string>(L::TEXT, L::TEXT + L::ROWS), l);
+        layouts.push_back(l);
+    }
+};
+
+inline const std::vector<BoardLayout>& standardLayouts() {
+    static const StandardLayouts standard;
+    return standard.layouts;
+}
+
+inline const BoardLayout* findLayout(const std::string& name) {
+    const std::vector<BoardLayout>& all = standardLayouts();
+    for (std::size_t i = 0; i < all.size(); i++)
+        if (all[i].name == name) return &all[i];
+    return nullptr;
+}
+
+// The layout under another rule set. Rules only change square grids, and
+// only standard types carry the BOARD_DIAGONAL flag.
+inline BoardLayout withRules(const BoardLayout& l, int rules) {
+    BoardLayout out = l;
+    out.rules = static_cast<uint8_t>(l.grid == GRID_SQUARE ? rules : RULES_ORTHOGONAL);
+    if (out.type != BOARD_CUSTOM) out.type = static_cast<uint8_t>((out.type & ~BOARD_DIAGONAL) | (out.rules == RULES_DIAGONAL ? BOARD_DIAGONAL : 0));
+    return out;
+}
+
+// Names a layout and its rules, e.g. "english orthogonal", for files that
+// only hold for one of them.
+inline std::string layoutKey(const BoardLayout& l) { return l.name + (l.rules == RULES_DIAGONAL ? " diagonal" : " orthogonal"); }
+
+// Standard layout for a recorded board type, rules included.
+inline bool layoutForType(int type, BoardLayout& out) {
+    if (type == BOARD_CUSTOM) return false;
+    const std::vector<BoardLayout>& all = standardLayouts();
+    for (std::size_t i = 0; i < all.size(); i++)
+        if (all[i].type == (type & ~BOARD_DIAGONAL)) {
+            out = withRules(all[i], type & BOARD_DIAGONAL ? RULES_DIAGONAL : RULES_ORTHOGONAL);
+            return out.type == type;
+        }
+    return false;
+}
+
+// Reads a layout file in the parseLayout() format; lines starting with '#'
+// are comments and a line "grid hex" switches to the hex grid.
+inline bool loadLayoutFile(const char* path, BoardLayout& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Error opening layout file: '%s'\n", path);
+        return false;
+    }
+    std::vector<std::string> lines;
+    int grid = GRID_SQUARE;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), f)) {
+        std::string line = buf;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (!line.empty() && line[0] == '#') continue;
+        if (line == "grid hex" || line == "grid square") {
+            grid = line == "grid hex" ? GRID_HEX : GRID_SQUARE;
+            continue;
+        }
+        if (!line.empty() || !lines.empty()) lines.push_back(line);
+    }
+    fclose(f);
+    while (!lines.empty() && lines.back().empty()) lines.pop_back();
+    return parseLayout(path, BOARD_CUSTOM, grid, lines, out);
+}
+
+#endif
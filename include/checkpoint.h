@@ -0,0 +1,122 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "position_file.h"
+
+// The small part of a checkpoint: "key value" lines, replaced whole and
+// durably (see replaceFile()), so after a crash the file on disk is the last
+// one saved. Bulk state goes in files of its own that are committed before
+// the state file naming them.
+class CheckpointState {
+public:
+    void set(const std::string& key, const std::string& value) {
+        for (std::size_t i = 0; i < entries.size(); i++)
+            if (entries[i].first == key) {
+                entries[i].second = value;
+                return;
+            }
+        entries.push_back(std::make_pair(key, value));
+    }
+
+    void setInt(const std::string& key, int64_t value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%lld", static_cast<long long>(value));
+        set(key, text);
+    }
+
+    void setReal(const std::string& key, double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.3f", value);
+        set(key, text);
+    }
+
+    bool has(const std::string& key) const { return find(key) != nullptr; }
+    std::string get(const std::string& key) const { return find(key) ? *find(key) : std::string(); }
+    int64_t getInt(const std::string& key, int64_t fallback = 0) const { return find(key) ? strtoll(find(key)->c_str(), nullptr, 10) : fallback; }
+    double getReal(const std::string& key) const { return find(key) ? atof(find(key)->c_str()) : 0.0; }
+
+    bool save(const std::string& path) const {
+        std::string text;
+        for (std::size_t i = 0; i < entries.size(); i++) text += entries[i].first + " " + entries[i].second + "\n";
+        return replaceFile(path, text);
+    }
+
+    bool load(const std::string& path) {
+        entries.clear();
+        FILE* f = fopen(path.c_str(), "r");
+        if (!f) return false;
+        char line[1024];
+        while (fgets(line, sizeof(line), f)) {
+            std::string l = line;
+            while (!l.empty() && (l.back() == '\n' || l.back() == '\r')) l.pop_back();
+            std::size_t space = l.find(' ');
+            if (space != std::string::npos) set(l.substr(0, space), l.substr(space + 1));
+        }
+        fclose(f);
+        return true;
+    }
+
+private:
+    const std::string* find(const std::string& key) const {
+        for (std::size_t i = 0; i < entries.size(); i++)
+            if (entries[i].first == key) return &entries[i].second;
+        return nullptr;
+    }
+
+    std::vector<std::pair<std::string, std::string>> entries;
+};
+
+// When checkpoints are due, and what they have cost. Jobs keep their totals
+// in their state so the cost reported after a resume covers the whole job.
+class CheckpointClock {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // interval <= 0 never asks for a checkpoint.
+    explicit CheckpointClock(double intervalSeconds = 0.0) : interval(intervalSeconds), count(0), seconds(0.0), writing(false), last(Clock::now()) {}
+
+    bool enabled() const { return interval > 0.0; }
+    bool due() const { return interval > 0.0 && std::chrono::duration<double>(Clock::now() - last).count() >= interval; }
+
+    // Brackets the writing of one checkpoint.
+    void begin() {
+        started = Clock::now();
+        writing = true;
+    }
+    void end() {
+        writing = false;
+        last = Clock::now();
+        count++;
+        seconds += std::chrono::duration<double>(last - started).count();
+    }
+
+    void restore(const CheckpointState& s) {
+        count = s.getInt("checkpoints");
+        seconds = s.getReal("checkpoint_seconds");
+    }
+    // Inside begin()/end() the totals include the checkpoint being written.
+    void store(CheckpointState& s) const {
+        s.setInt("checkpoints", static_cast<int64_t>(count) + writing);
+        s.setReal("checkpoint_seconds", seconds + (writing ? std::chrono::duration<double>(Clock::now() - started).count() : 0.0));
+    }
+
+    uint64_t checkpoints() const { return count; }
+    double totalSeconds() const { return seconds; }
+
+private:
+    double interval;
+    uint64_t count;
+    double seconds;
+    bool writing;
+    Clock::time_point started, last;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "peg_engine.h"
+
+enum LogLevel {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR,
+    LOG_OFF
+};
+
+enum LogEventType {
+    EVENT_MOVE,
+    EVENT_UNDO,
+    EVENT_REDO,
+    EVENT_RESTART,
+    EVENT_WIN
+};
+
+// Fixed-size record so producers only copy a few words into the ring.
+struct LogEvent {
+    uint64_t timeUs;        // filled in by EventLog::log
+    PegBits board;          // first 64 cells on wider boards
+    int32_t step;
+    int16_t pegs;
+    int16_t removed;
+    int8_t fromRow, fromCol, toRow, toCol;     // -1 when not a jump
+    uint8_t type;           // LogEventType
+    uint8_t level;          // LogLevel
+};
+
+// Bounded multi-producer ring (Vyukov) drained by a background thread that
+// writes one JSON object per line. log() never blocks or allocates: when the
+// ring is full the event is dropped and counted.
+class EventLog {
+public:
+    static const uint32_t CAPACITY = 4096;
+
+    EventLog() : minLevel(LOG_OFF), out(nullptr), ownsFile(false), stopping(false), head(0), tail(0), droppedCount(0) {
+        for (uint32_t i = 0; i < CAPACITY; i++) slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    ~EventLog() { close(); }
+
+    // path == nullptr logs to stdout. Returns false if the file can't be opened.
+    bool open(LogLevel level, const char* path) {
+        close();
+        minLevel = level;
+        if (level == LOG_OFF) return true;
+        out = stdout;
+        if (path && !(out = fopen(path, "a"))) {
+            fprintf(stderr, "Error opening log file: '%s'\n", path);
+            minLevel = LOG_OFF;
+            return false;
+        }
+        ownsFile = path != nullptr;
+        epoch = std::chrono::steady_clock::now();
+        stopping.store(false);
+        flusher = std::thread(&EventLog::flushLoop, this);
+        return true;
+    }
+
+    void close() {
+        if (flusher.joinable()) {
+            stopping.store(true);
+            flusher.join();
+        }
+        if (out && ownsFile) fclose(out);
+        else if (out) fflush(out);
+        out = nullptr;
+        ownsFile = false;
+        minLevel = LOG_OFF;
+    }
+
+    bool enabled(LogLevel level) const { return level >= minLevel; }
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+    void log(LogEvent e) {
+        if (!enabled(static_cast<LogLevel>(e.level))) return;
+        e.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& s = slots[pos & (CAPACITY - 1)];
+            uint32_t seq = s.seq.load(std::memory_order_acquire);
+            int32_t diff = static_cast<int32_t>(seq - pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.event = e;
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            }
+            else if (diff < 0) {
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        LogEvent event;
+    };
+
+    bool pop(LogEvent& e) {
+        Slot& s = slots[tail & (CAPACITY - 1)];
+        if (s.seq.load(std::memory_order_acquire) != tail + 1) return false;
+        e = s.event;
+        s.seq.store(tail + CAPACITY, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+    void flushLoop() {
+        std::vector<char> buffer;
+        buffer.reserve(1 << 16);
+        uint64_t reportedDrops = 0;
+        for (;;) {
+            bool last = stopping.load();
+            LogEvent e;
+            while (pop(e)) append(buffer, e);
+            uint64_t drops = dropped();
+            if (drops != reportedDrops) {
+                char line[96];
+                int n = snprintf(line, sizeof(line), "{\"level\":\"warn\",\"event\":\"dropped\",\"count\":%llu}\n", static_cast<unsigned long long>(drops - reportedDrops));
+                buffer.insert(buffer.end(), line, line + n);
+                reportedDrops = drops;
+            }
+            if (!buffer.empty()) {
+                fwrite(&buffer[0], 1, buffer.size(), out);
+                fflush(out);
+                buffer.clear();
+            }
+            if (last) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    static void append(std::vector<char>& buffer, const LogEvent& e) {
+        static const char* levels[] = {"debug", "info", "warn", "error"};
+        static const char* types[] = {"move", "undo", "redo", "restart", "win"};
+        char line[256];
+        int n = snprintf(line, sizeof(line), "{\"t_us\":%llu,\"level\":\"%s\",\"event\":\"%s\",\"step\":%d,\"pegs\":%d,\"removed\":%d,\"board\":\"%016llx\"",
+                         static_cast<unsigned long long>(e.timeUs), levels[e.level], types[e.type], e.step, e.pegs, e.removed,
+                         static_cast<unsigned long long>(e.board));
+        if (e.fromRow >= 0)
+            n += snprintf(line + n, sizeof(line) - n, ",\"from\":[%d,%d],\"to\":[%d,%d]", e.fromRow, e.fromCol, e.toRow, e.toCol);
+        n += snprintf(line + n, sizeof(line) - n, "}\n");
+        buffer.insert(buffer.end(), line, line + n);
+    }
+
+    LogLevel minLevel;
+    FILE* out;
+    bool ownsFile;
+    std::chrono::steady_clock::time_point epoch;
+    std::atomic<bool> stopping;
+    std::thread flusher;
+    Slot slots[CAPACITY];
+    std::atomic<uint32_t> head;
+    uint32_t tail;
+    std::atomic<uint64_t> droppedCount;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef EXTERNAL_BFS_H
+#define EXTERNAL_BFS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "peg_engine.h"
+#include "position_file.h"
+
+// What an enumeration directory holds and how far it has got. Saved as a
+// checkpoint state file, bfs.state, after every finished layer and at each
+// checkpoint inside one.
+struct BfsState {
+    std::string board;      // layout name and rules, e.g. "english orthogonal"
+    int cells;
+    int target;             // cell of the last peg
+    std::string start;      // '1' per cell holding a peg
+    int reach;              // lowest peg count whose reach layer is written
+    int win;                // highest peg count whose win layer is written, 0 if none
+    uint64_t offset;        // positions of the layer being read whose neighbours are in runs
+    uint64_t runs;          // runs of the layer being built that are on disk
+    uint64_t read;          // positions read over the whole job
+
+    int top() const { return static_cast<int>(std::count(start.begin(), start.end(), '1')); }
+    bool finished() const { return reach <= 1 && win >= top(); }
+};
+
+inline std::string bfsStatePath(const std::string& dir) { return dir + "/bfs.state"; }
+
+inline bool saveBfsState(const std::string& dir, const BfsState& s, const CheckpointClock& clock) {
+    CheckpointState c;
+    c.set("board", s.board);
+    c.set("start", s.start);
+    c.setInt("cells", s.cells);
+    c.setInt("target", s.target);
+    c.setInt("reach", s.reach);
+    c.setInt("win", s.win);
+    c.setInt("offset", static_cast<int64_t>(s.offset));
+    c.setInt("runs", static_cast<int64_t>(s.runs));
+    c.setInt("read", static_cast<int64_t>(s.read));
+    clock.store(c);
+    return c.save(bfsStatePath(dir));
+}
+
+inline bool loadBfsState(const std::string& dir, BfsState& s, CheckpointClock* clock = nullptr) {
+    CheckpointState c;
+    if (!c.load(bfsStatePath(dir)) || !c.has("board") || !c.has("start") || !c.has("reach") || !c.has("win")) return false;
+    s.board = c.get("board");
+    s.start = c.get("start");
+    s.cells = static_cast<int>(c.getInt("cells"));
+    s.target = static_cast<int>(c.getInt("target", -1));
+    s.reach = static_cast<int>(c.getInt("reach"));
+    s.win = static_cast<int>(c.getInt("win"));
+    s.offset = c.getInt("offset");
+    s.runs = c.getInt("runs");
+    s.read = c.getInt("read");
+    if (clock) clock->restore(c);
+    return true;
+}
+
+inline std::string bfsLayerPath(const std::string& dir, const char* kind, int pegs) {
+    char name[32];
+    snprintf(name, sizeof(name), "/%s-%03d.bin", kind, pegs);
+    return dir + name;
+}
+
+// Level-synchronous breadth-first enumeration of every position reachable
+// from a start, one peg count at a time, in files rather than memory. Each
+// layer is read once in order; the canonical children (up to the symmetries
+// that fix the target) collect in a buffer of the memory budget, which is
+// sorted and written out as a run whenever it fills, and the runs are then
+// merged into the next layer with duplicates dropped. Every file access is
+// sequential.
+//
+// A second pass from the goal up keeps the winnable positions of each layer:
+// those with a child among the winnable positions one peg down, found the
+// same way from their parents and merged against the layer. The directory's
+// reach-NNN.bin and win-NNN.bin files are the game's winnability database
+// (win_database.h).
+//
+// The state file is replaced after every layer and, every checkpoint
+// interval, inside one: the sort buffer is written out as a run early and
+// the state records how far into the layer being read the runs go. An
+// interrupted job goes on from its last checkpoint by calling resume()
+// instead of start().
+template <class Engine>
+class BasicExternalBfs {
+public:
+    typedef typename Engine::Bits Bits;
+
+    // Called every PROGRESS_INTERVAL positions read with the peg count of the
+    // layer being built and the positions read so far; returning false stops
+    // the run after the last finished layer.
+    typedef std::function<bool(int, uint64_t)> Progress;
+    static const uint64_t PROGRESS_INTERVAL = 1 << 20;
+    static const std::size_t MEMORY_BYTES = std::size_t(1) << 30;
+
+    // Runs go to tmpDirectory, which (like directory) belongs to one job at
+    // a time.
+    BasicExternalBfs(const Engine& e, const std::string& directory, const std::string& tmpDirectory, std::size_t memoryBytes = MEMORY_BYTES,
+                     double checkpointSeconds = 0.0)
+        : engine(e), dir(directory), tmpDir(tmpDirectory), maxBuffer(std::max<std::size_t>(memoryBytes / sizeof(Bits), 1024)), runCount(0),
+          aborted(false), clock(checkpointSeconds) {}
+
+    // Starts over in the directory, creating it if needed.
+    bool start(const std::string& board, Bits pegs, int targetCell) {
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Error creating directory: '%s'\n", dir.c_str());
+            return false;
+        }
+        state.board = board;
+        state.cells = engine.numCells();
+        state.target = targetCell;
+        state.start.assign(engine.numCells(), '0');
+        for (int i = 0; i < engine.numCells(); i++)
+            if (pegs & Engine::bit(i)) state.start[i] = '1';
+        state.reach = state.top();
+        state.win = 0;
+        state.offset = state.runs = state.read = 0;
+        findStabilizer();
+        removeStaleRuns();
+        PositionWriter<Bits> w;
+        if (!w.open(bfsLayerPath(dir, "reach", state.reach))) return false;
+        w.put(canonical(pegs));
+        return w.commit(true) && save();
+    }
+
+    // Picks up an earlier run on the same board; false if there is none.
+    bool resume(const std::string& board) {
+        if (!loadBfsState(dir, state, &clock)) {
+            fprintf(stderr, "No enumeration to resume in '%s'\n", dir.c_str());
+            return false;
+        }
+        if (state.board != board || state.cells != engine.numCells()) {
+            fprintf(stderr, "'%s' holds an enumeration of %s\n", dir.c_str(), state.board.c_str());
+            return false;
+        }
+        findStabilizer();
+        removeStaleRuns();
+        return true;
+    }
+
+    // Builds the remaining layers; false if cancelled or on a write error.
+    bool run(const Progress& progress = Progress()) {
+        onProgress = progress;
+        aborted = false;
+        while (state.reach > 1) {
+            int n = state.reach;
+            if (!nextLayer(bfsLayerPath(dir, "reach", n), false, nullptr, bfsLayerPath(dir, "reach", n - 1), n - 1)) return false;
+            state.reach = n - 1;
+            if (!finishLayer()) return false;
+        }
+        while (state.win < state.top()) {
+            int n = state.win + 1;
+            // The goal is its own source: its parents are what win one peg up.
+            if (n == 1) {
+                std::vector<Bits> goal(1, canonical(Engine::bit(state.target)));
+                if (!writeRun(goal, runPath(0), false)) return false;
+                runCount = 1;
+            }
+            if (!nextLayer(n == 1 ? std::string() : bfsLayerPath(dir, "win", n - 1), true, bfsLayerPath(dir, "reach", n).c_str(),
+                           bfsLayerPath(dir, "win", n), n))
+                return false;
+            state.win = n;
+            if (!finishLayer()) return false;
+        }
+        return true;
+    }
+
+    const BfsState& progressState() const { return state; }
+    uint64_t layerSize(const char* kind, int pegs) const {
+        PositionReader<Bits> r;
+        return r.open(bfsLayerPath(dir, kind, pegs)) ? r.size() : 0;
+    }
+    uint64_t positionsRead() const { return state.read; }
+    bool cancelled() const { return aborted; }
+    // Checkpoints written over the whole job, layer ends included, and the
+    // time spent writing them.
+    uint64_t checkpoints() const { return clock.checkpoints(); }
+    double checkpointSeconds() const { return clock.totalSeconds(); }
+
+private:
+    void findStabilizer() {
+        stabilizer.clear();
+        for (int s = 1; s < engine.numSymmetries(); s++)
+            if (engine.symmetryCell(s, state.target) == state.target) stabilizer.push_back(s);
+    }
+
+    Bits canonical(Bits pegs) const {
+        Bits best = pegs;
+        for (std::size_t i = 0; i < stabilizer.size(); i++) {
+            Bits p = engine.transform(pegs, stabilizer[i]);
+            if (p < best) best = p;
+        }
+        return best;
+    }
+
+    std::string runPath(std::size_t k) const {
+        char name[48];
+        snprintf(name, sizeof(name), "/run-%06zu.bin", k);
+        return tmpDir + name;
+    }
+
+    bool save() {
+        clock.begin();
+        bool ok = saveBfsState(dir, state, clock);
+        clock.end();
+        if (!ok) fprintf(stderr, "Error saving state: '%s'\n", bfsStatePath(dir).c_str());
+        return ok;
+    }
+
+    // The runs of a finished layer go once the state no longer needs them.
+    bool finishLayer() {
+        state.offset = state.runs = 0;
+        bool ok = save();
+        for (std::size_t k = 0; k < runCount; k++) unlink(runPath(k).c_str());
+        runCount = 0;
+        return ok;
+    }
+
+    // Makes everything read so far part of a run the state counts on. With
+    // checkpoints on, every run is written durably.
+    bool checkpoint(uint64_t offset) {
+        clock.begin();
+        bool ok = buffer.empty() || writeRun(buffer, runPath(runCount++), true);
+        if (ok) {
+            state.offset = offset;
+            state.runs = runCount;
+            ok = saveBfsState(dir, state, clock);
+        }
+        clock.end();
+        return ok;
+    }
+
+    // Writes to out the canonical children of the positions in from (their
+    // parents, going backward), restricted to keep if given. An empty from
+    // uses the runs already written. Reading starts after the positions a
+    // checkpoint already covers.
+    bool nextLayer(const std::string& from, bool backward, const char* keep, const std::string& out, int pegs) {
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        if (!from.empty()) {
+            runCount = state.runs;
+            uint64_t offset = state.offset;
+            PositionReader<Bits> reader;
+            if (!reader.open(from) || !reader.seek(offset)) {
+                fprintf(stderr, "Error reading layer: '%s'\n", from.c_str());
+                return false;
+            }
+            buffer.reserve(maxBuffer);
+            Bits p;
+            while (reader.next(p)) {
+                int n = engine.generateMoves(backward ? engine.fullBoard() ^ p : p, moves);
+                for (int k = 0; k < n; k++) buffer.push_back(canonical(p ^ engine.jumps()[moves[k]].flip));
+                offset++;
+                if (buffer.size() + engine.numJumps() > maxBuffer && !writeRun(buffer, runPath(runCount++), clock.enabled())) return cleanUp();
+                if ((++state.read % PROGRESS_INTERVAL) == 0) {
+                    if (onProgress && !onProgress(pegs, state.read)) {
+                        aborted = true;
+                        return cleanUp();
+                    }
+                    if (clock.due() && !checkpoint(offset)) return cleanUp();
+                }
+            }
+            if (reader.failed()) {
+                fprintf(stderr, "Error reading layer: '%s'\n", from.c_str());
+                return cleanUp();
+            }
+            if (!buffer.empty() && !writeRun(buffer, runPath(runCount++), clock.enabled())) return cleanUp();
+        }
+        std::vector<std::string> runs;
+        for (std::size_t k = 0; k < runCount; k++) runs.push_back(runPath(k));
+        PositionReader<Bits> kept;
+        if (keep && !kept.open(keep)) return cleanUp();
+        PositionWriter<Bits> w;
+        if (w.open(out) && mergeRuns(runs, keep ? &kept : nullptr, w) && w.commit(true)) return true;
+        return cleanUp();
+    }
+
+    // Runs an interrupted job wrote after its last checkpoint.
+    void removeStaleRuns() {
+        for (std::size_t k = state.runs; unlink(runPath(k).c_str()) == 0 || errno != ENOENT; k++) {}
+    }
+
+    // Drops the runs the state doesn't count on; false, for error returns.
+    bool cleanUp() {
+        buffer.clear();
+        for (std::size_t k = state.runs; k < runCount; k++) unlink(runPath(k).c_str());
+        runCount = state.runs;
+        return false;
+    }
+
+    const Engine& engine;
+    std::string dir, tmpDir;
+    std::size_t maxBuffer;          // positions
+    BfsState state;
+    std::vector<int> stabilizer;    // symmetries other than the identity that fix the target
+    std::vector<Bits> buffer;
+    std::size_t runCount;
+    bool aborted;
+    Progress onProgress;
+    CheckpointClock clock;
+};
+
+typedef BasicExternalBfs<PegEngine> ExternalBfs;
+
+#endif
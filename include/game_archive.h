@@ -0,0 +1,277 @@
+#ifndef GAME_ARCHIVE_H
+#define GAME_ARCHIVE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "game_record.h"
+
+enum GameOutcome {
+    OUTCOME_ABANDONED,      // restarted or quit with moves on the board
+    OUTCOME_WON,
+    OUTCOME_STUCK           // no moves left, not a win
+};
+
+enum FsyncPolicy {
+    FSYNC_NEVER,            // leave it to the OS
+    FSYNC_BATCH,            // once per flushed batch
+    FSYNC_ALWAYS            // after every appended game
+};
+
+// Fixed-size sidecar entry; queries scan these without touching the records.
+struct ArchiveIndexEntry {
+    uint64_t offset;        // of the record in the segment's .dat file
+    uint64_t endedAtMs;     // wall clock, milliseconds since the epoch
+    uint32_t durationMs;
+    uint16_t size;          // encoded record bytes
+    uint8_t boardType;
+    uint8_t startHole;
+    uint8_t targetHole;
+    uint8_t moveCount;
+    uint8_t pegsLeft;
+    uint8_t outcome;        // GameOutcome
+    uint8_t reserved[4];
+};
+
+// An archive is a directory of segments seg-NNNNNN.dat (records back to back,
+// see game_record.h) and seg-NNNNNN.idx (one ArchiveIndexEntry per record).
+// Both files are append-only; a segment is closed once its data passes
+// segmentBytes.
+class GameArchiveWriter {
+public:
+    GameArchiveWriter() : dataFd(-1), indexFd(-1), segment(0), dataSize(0), entryCount(0), policy(FSYNC_BATCH), batchSize(64), segmentBytes(64u << 20) {}
+    ~GameArchiveWriter() { close(); }
+
+    // Opens (creating if needed) the archive and resumes after the last
+    // complete entry; anything a crash left past it is truncated away.
+    bool open(const std::string& directory, FsyncPolicy fsyncPolicy = FSYNC_BATCH, std::size_t batch = 64) {
+        close();
+        dir = directory;
+        policy = fsyncPolicy;
+        batchSize = batch ? batch : 1;
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Error creating archive directory: '%s'\n", dir.c_str());
+            return false;
+        }
+        segment = 0;
+        while (access(segmentPath(segment + 1, ".idx").c_str(), F_OK) == 0) segment++;
+        return openSegment();
+    }
+
+    void append(const GameRecord& r, const ArchiveIndexEntry& meta) {
+        ArchiveIndexEntry e = meta;
+        e.offset = dataSize + pendingData.size();
+        e.size = static_cast<uint16_t>(encodedSize(r));
+        e.boardType = r.boardType;
+        e.startHole = r.startHole;
+        e.targetHole = r.targetHole;
+        e.moveCount = static_cast<uint8_t>(r.moves.size());
+        memset(e.reserved, 0, sizeof(e.reserved));
+        encodeRecord(r, pendingData);
+        pendingIndex.push_back(e);
+        if (policy == FSYNC_ALWAYS || pendingIndex.size() >= batchSize) flush();
+    }
+
+    // Writes the pending batch: data first, then the index entries that point
+    // into it, so a reader never sees an entry without its record. A batch
+    // that fails is dropped and both files are cut back to the last good
+    // one, so later entries' offsets still match the data.
+    bool flush() {
+        if (pendingIndex.empty() || dataFd < 0) return dataFd >= 0;
+        bool ok = writeAll(dataFd, &pendingData[0], pendingData.size());
+        if (ok && policy != FSYNC_NEVER) ok = fsync(dataFd) == 0;
+        if (ok) ok = writeAll(indexFd, &pendingIndex[0], pendingIndex.size() * sizeof(ArchiveIndexEntry));
+        if (ok && policy != FSYNC_NEVER) ok = fsync(indexFd) == 0;
+        if (ok) {
+            dataSize += pendingData.size();
+            entryCount += pendingIndex.size();
+        }
+        else {
+            fprintf(stderr, "Error writing archive segment %u\n", segment);
+            if (ftruncate(indexFd, entryCount * sizeof(ArchiveIndexEntry)) != 0 || ftruncate(dataFd, dataSize) != 0)
+                fprintf(stderr, "Error truncating archive segment %u\n", segment);
+            lseek(indexFd, 0, SEEK_END);
+            lseek(dataFd, 0, SEEK_END);
+        }
+        pendingData.clear();
+        pendingIndex.clear();
+        if (ok && dataSize >= segmentBytes) {
+            closeSegment();
+            segment++;
+            ok = openSegment();
+        }
+        return ok;
+    }
+
+    void close() {
+        flush();
+        closeSegment();
+    }
+
+private:
+    std::string segmentPath(unsigned n, const char* ext) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/seg-%06u%s", n, ext);
+        return dir + name;
+    }
+
+    bool openSegment() {
+        dataFd = ::open(segmentPath(segment, ".dat").c_str(), O_RDWR | O_CREAT, 0644);
+        indexFd = ::open(segmentPath(segment, ".idx").c_str(), O_RDWR | O_CREAT, 0644);
+        if (dataFd < 0 || indexFd < 0) {
+            fprintf(stderr, "Error opening archive segment in '%s'\n", dir.c_str());
+            closeSegment();
+            return false;
+        }
+        struct stat st;
+        fstat(indexFd, &st);
+        off_t entries = st.st_size / sizeof(ArchiveIndexEntry);
+        dataSize = 0;
+        if (entries > 0) {
+            ArchiveIndexEntry last;
+            if (pread(indexFd, &last, sizeof(last), (entries - 1) * sizeof(ArchiveIndexEntry)) == static_cast<ssize_t>(sizeof(last)))
+                dataSize = last.offset + last.size;
+        }
+        entryCount = entries;
+        if (ftruncate(indexFd, entries * sizeof(ArchiveIndexEntry)) != 0 || ftruncate(dataFd, dataSize) != 0) return false;
+        lseek(indexFd, 0, SEEK_END);
+        lseek(dataFd, 0, SEEK_END);
+        return true;
+    }
+
+    void closeSegment() {
+        if (dataFd >= 0) ::close(dataFd);
+        if (indexFd >= 0) ::close(indexFd);
+        dataFd = indexFd = -1;
+    }
+
+    static bool writeAll(int fd, const void* data, std::size_t n) {
+        const char* p = static_cast<const char*>(data);
+        while (n > 0) {
+            ssize_t w = write(fd, p, n);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            p += w;
+            n -= w;
+        }
+        return true;
+    }
+
+    std::string dir;
+    int dataFd, indexFd;
+    unsigned segment;
+    uint64_t dataSize;
+    uint64_t entryCount;    // in the segment's index, not counting the pending batch
+    FsyncPolicy policy;
+    std::size_t batchSize;
+    uint64_t segmentBytes;
+    std::vector<uint8_t> pendingData;
+    std::vector<ArchiveIndexEntry> pendingIndex;
+};
+
+// Read-only view of every segment through mmap. Entries are addressed by a
+// global index across segments.
+class GameArchiveReader {
+public:
+    GameArchiveReader() : total(0) {}
+    ~GameArchiveReader() { close(); }
+
+    bool open(const std::string& dir) {
+        close();
+        for (unsigned n = 0;; n++) {
+            char name[32];
+            snprintf(name, sizeof(name), "/seg-%06u", n);
+            Segment s;
+            if (!mapFile(dir + name + ".idx", s.index, s.indexBytes)) break;
+            if (!mapFile(dir + name + ".dat", s.data, s.dataBytes)) {
+                unmap(s.index, s.indexBytes);
+                break;
+            }
+            s.first = total;
+            s.count = s.indexBytes / sizeof(ArchiveIndexEntry);
+            total += s.count;
+            segments.push_back(s);
+        }
+        return !segments.empty();
+    }
+
+    void close() {
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            unmap(segments[i].index, segments[i].indexBytes);
+            unmap(segments[i].data, segments[i].dataBytes);
+        }
+        segments.clear();
+        total = 0;
+    }
+
+    uint64_t size() const { return total; }
+    std::size_t numSegments() const { return segments.size(); }
+
+    const ArchiveIndexEntry* segmentEntries(std::size_t s, uint64_t& count) const {
+        count = segments[s].count;
+        return static_cast<const ArchiveIndexEntry*>(segments[s].index);
+    }
+
+    const ArchiveIndexEntry& entry(uint64_t i) const {
+        const Segment& s = find(i);
+        return static_cast<const ArchiveIndexEntry*>(s.index)[i - s.first];
+    }
+
+    bool record(uint64_t i, GameRecord& r) const {
+        const Segment& s = find(i);
+        const ArchiveIndexEntry& e = static_cast<const ArchiveIndexEntry*>(s.index)[i - s.first];
+        if (e.offset + e.size > s.dataBytes) return false;
+        return decodeRecord(static_cast<const uint8_t*>(s.data) + e.offset, e.size, r) == e.size;
+    }
+
+private:
+    struct Segment {
+        void* index;
+        void* data;
+        std::size_t indexBytes, dataBytes;
+        uint64_t first, count;
+    };
+
+    const Segment& find(uint64_t i) const {
+        std::size_t lo = 0, hi = segments.size() - 1;
+        while (lo < hi) {
+            std::size_t mid = (lo + hi + 1) / 2;
+            if (segments[mid].first <= i) lo = mid;
+            else hi = mid - 1;
+        }
+        return segments[lo];
+    }
+
+    static bool mapFile(const std::string& path, void*& addr, std::size_t& bytes) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        fstat(fd, &st);
+        bytes = st.st_size;
+        addr = nullptr;
+        if (bytes > 0) {
+            addr = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) addr = nullptr;
+            else madvise(addr, bytes, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        return bytes == 0 || addr != nullptr;
+    }
+
+    static void unmap(void* addr, std::size_t bytes) {
+        if (addr) munmap(addr, bytes);
+    }
+
+    std::vector<Segment> segments;
+    uint64_t total;
+};
+
+#endif
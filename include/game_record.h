@@ -0,0 +1,180 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "board_layout.h"
+#include "peg_engine.h"
+
+// A finished or partial game: the start position is the full board minus
+// startHole, moves are engine jump indices.
+struct GameRecord {
+    uint8_t boardType;
+    uint8_t bitsPerMove;
+    uint8_t startHole;
+    uint8_t targetHole;
+    std::vector<uint16_t> moves;
+
+    GameRecord() : boardType(BOARD_ENGLISH), bitsPerMove(7), startHole(0), targetHole(0) {}
+};
+
+// Smallest width that holds every jump index (7 for the 76 jumps of the
+// English board).
+inline int moveBits(int numJumps) {
+    int bits = 1;
+    while ((1 << bits) < numJumps) bits++;
+    return bits;
+}
+
+struct Crc32Table {
+    uint32_t entry[256];
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entry[i] = c;
+        }
+    }
+};
+
+inline uint32_t crc32(const uint8_t* data, std::size_t n, uint32_t crc = 0) {
+    static const Crc32Table table;
+    crc = ~crc;
+    for (std::size_t i = 0; i < n; i++) crc = table.entry[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Record layout (a full 31-move English game is 5 + 28 + 4 = 37 bytes):
+//   u8 board type, u8 bits per move, u8 start hole, u8 target hole,
+//   u8 move count, moves packed LSB-first at bitsPerMove bits each,
+//   u32 little-endian CRC-32 of everything before it.
+inline std::size_t encodedSize(const GameRecord& r) {
+    return 5 + (r.moves.size() * r.bitsPerMove + 7) / 8 + 4;
+}
+
+inline void encodeRecord(const GameRecord& r, std::vector<uint8_t>& out) {
+    std::size_t base = out.size();
+    out.push_back(r.boardType);
+    out.push_back(r.bitsPerMove);
+    out.push_back(r.startHole);
+    out.push_back(r.targetHole);
+    out.push_back(static_cast<uint8_t>(r.moves.size()));
+    uint32_t acc = 0;
+    int filled = 0;
+    for (std::size_t i = 0; i < r.moves.size(); i++) {
+        acc |= static_cast<uint32_t>(r.moves[i]) << filled;
+        filled += r.bitsPerMove;
+        while (filled >= 8) {
+            out.push_back(acc & 0xff);
+            acc >>= 8;
+            filled -= 8;
+        }
+    }
+    if (filled > 0) out.push_back(acc & 0xff);
+    uint32_t crc = crc32(&out[base], out.size() - base);
+    for (int i = 0; i < 4; i++) out.push_back((crc >> (8 * i)) & 0xff);
+}
+
+// Decodes one record from data[0..n). Returns its size in bytes, or 0 if the
+// buffer is truncated, malformed or fails its checksum.
+inline std::size_t decodeRecord(const uint8_t* data, std::size_t n, GameRecord& r) {
+    if (n < 5) return 0;
+    int bits = data[1];
+    if (bits < 1 || bits > 16) return 0;
+    std::size_t count = data[4];
+    std::size_t size = 5 + (count * bits + 7) / 8 + 4;
+    if (n < size) return 0;
+    uint32_t stored = 0;
+    for (int i = 0; i < 4; i++) stored |= static_cast<uint32_t>(data[size - 4 + i]) << (8 * i);
+    if (crc32(data, size - 4) != stored) return 0;
+    r.boardType = data[0];
+    r.bitsPerMove = static_cast<uint8_t>(bits);
+    r.startHole = data[2];
+    r.targetHole = data[3];
+    r.moves.resize(count);
+    const uint8_t* p = data + 5;
+    uint32_t acc = 0;
+    int filled = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        while (filled < bits) {
+            acc |= static_cast<uint32_t>(*p++) << filled;
+            filled += 8;
+        }
+        r.moves[i] = static_cast<uint16_t>(acc & ((1u << bits) - 1));
+        acc >>= bits;
+        filled -= bits;
+    }
+    return size;
+}
+
+// Replays the record on the engine, checking that every jump is legal.
+template <class Engine>
+inline bool replayRecord(const Engine& e, const GameRecord& r, typename Engine::Bits& pegs) {
+    if (r.startHole >= e.numCells() || r.targetHole >= e.numCells()) return false;
+    pegs = e.fullBoard() ^ Engine::bit(r.startHole);
+    for (std::size_t i = 0; i < r.moves.size(); i++) {
+        if (r.moves[i] >= e.numJumps() || !e.isLegal(pegs, r.moves[i])) return false;
+        pegs = e.apply(pegs, r.moves[i]);
+    }
+    return true;
+}
+
+// A record file is "MSGR" followed by any number of records.
+class GameRecordWriter {
+public:
+    explicit GameRecordWriter(FILE* f) : file(f) {
+        fwrite("MSGR", 1, 4, file);
+    }
+
+    bool write(const GameRecord& r) {
+        buffer.clear();
+        encodeRecord(r, buffer);
+        return fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+    }
+
+private:
+    FILE* file;
+    std::vector<uint8_t> buffer;
+};
+
+class GameRecordReader {
+public:
+    explicit GameRecordReader(FILE* f) : file(f), valid(false), corrupt(false) {
+        char magic[4];
+        valid = fread(magic, 1, 4, file) == 4 && memcmp(magic, "MSGR", 4) == 0;
+    }
+
+    bool isValid() const { return valid; }
+    // True if reading stopped on a damaged record rather than end of file.
+    bool isCorrupt() const { return corrupt; }
+
+    bool next(GameRecord& r) {
+        if (!valid) return false;
+        uint8_t head[5];
+        std::size_t got = fread(head, 1, sizeof(head), file);
+        if (got == 0) return false;
+        if (got < sizeof(head) || head[1] < 1 || head[1] > 16) {
+            corrupt = true;
+            return false;
+        }
+        std::size_t size = 5 + (head[4] * head[1] + 7) / 8 + 4;
+        buffer.assign(head, head + sizeof(head));
+        buffer.resize(size);
+        if (fread(&buffer[5], 1, size - 5, file) != size - 5 || decodeRecord(&buffer[0], size, r) != size) {
+            corrupt = true;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    FILE* file;
+    bool valid;
+    bool corrupt;
+    std::vector<uint8_t> buffer;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef INPUT_RECORD_H
+#define INPUT_RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+enum InputKind {
+    INPUT_KEY,
+    INPUT_MOUSE_BUTTON
+};
+
+// One event as it reached key_callback or mouse_button_callback. time is in
+// seconds since the game's startTime; for mouse events x/y is the cursor
+// position the handler saw.
+struct InputEvent {
+    double time;
+    uint8_t kind;       // InputKind
+    uint8_t action;
+    uint8_t mods;
+    int16_t code;       // key or mouse button
+    int16_t scancode;
+    float x, y;
+};
+
+// How the game acted on the logged events; a replay must act the same way.
+enum InputLogFlags {
+    INPUT_LOG_CLICK_ON_PRESS = 1    // mouse buttons act on press, not release
+};
+
+// Binary input log: "MSIR", u16 version, u16 flags (InputLogFlags; 0 in
+// logs from before there were any), then one 20-byte little-endian record
+// per event:
+//   u32 microseconds since the previous event, u8 kind, u8 action, u8 mods,
+//   u8 reserved, i16 code, i16 scancode, f32 x, f32 y
+class InputRecorder {
+public:
+    static const uint16_t VERSION = 1;
+    static const int RECORD_SIZE = 20;
+
+    InputRecorder() : file(nullptr), lastUs(0) {}
+    ~InputRecorder() { close(); }
+
+    bool open(const char* path, uint16_t flags = 0) {
+        close();
+        file = fopen(path, "wb");
+        if (!file) {
+            fprintf(stderr, "Error opening input log: '%s'\n", path);
+            return false;
+        }
+        uint8_t header[8] = {'M', 'S', 'I', 'R', VERSION & 0xff, VERSION >> 8, static_cast<uint8_t>(flags & 0xff), static_cast<uint8_t>(flags >> 8)};
+        fwrite(header, 1, sizeof(header), file);
+        lastUs = 0;
+        return true;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Buffered by stdio; input arrives at human rates, so this never holds
+    // up a frame in practice.
+    void record(const InputEvent& e) {
+        if (!file) return;
+        uint64_t us = e.time > 0.0 ? static_cast<uint64_t>(e.time * 1e6 + 0.5) : 0;
+        uint64_t delta = us > lastUs ? us - lastUs : 0;
+        if (delta > 0xffffffffULL) delta = 0xffffffffULL;
+        lastUs += delta;
+        uint8_t rec[RECORD_SIZE];
+        putU32(rec, static_cast<uint32_t>(delta));
+        rec[4] = e.kind;
+        rec[5] = e.action;
+        rec[6] = e.mods;
+        rec[7] = 0;
+        putU16(rec + 8, static_cast<uint16_t>(e.code));
+        putU16(rec + 10, static_cast<uint16_t>(e.scancode));
+        uint32_t fx, fy;
+        memcpy(&fx, &e.x, 4);
+        memcpy(&fy, &e.y, 4);
+        putU32(rec + 12, fx);
+        putU32(rec + 16, fy);
+        fwrite(rec, 1, RECORD_SIZE, file);
+    }
+
+    void close() {
+        if (file) fclose(file);
+        file = nullptr;
+    }
+
+    static bool load(const char* path, std::vector<InputEvent>& events, uint16_t* flags = nullptr) {
+        FILE* f = fopen(path, "rb");
+        if (!f) {
+            fprintf(stderr, "Error opening input log: '%s'\n", path);
+            return false;
+        }
+        uint8_t header[8];
+        if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, "MSIR", 4) != 0 || (header[4] | (header[5] << 8)) != VERSION) {
+            fprintf(stderr, "Not an input log: '%s'\n", path);
+            fclose(f);
+            return false;
+        }
+        if (flags) *flags = static_cast<uint16_t>(header[6] | (header[7] << 8));
+        events.clear();
+        uint64_t us = 0;
+        uint8_t rec[RECORD_SIZE];
+        while (fread(rec, 1, RECORD_SIZE, f) == static_cast<size_t>(RECORD_SIZE)) {
+            InputEvent e;
+            us += getU32(rec);
+            e.time = us * 1e-6;
+            e.kind = rec[4];
+            e.action = rec[5];
+            e.mods = rec[6];
+            e.code = static_cast<int16_t>(getU16(rec + 8));
+            e.scancode = static_cast<int16_t>(getU16(rec + 10));
+            uint32_t fx = getU32(rec + 12), fy = getU32(rec + 16);
+            memcpy(&e.x, &fx, 4);
+            memcpy(&e.y, &fy, 4);
+            events.push_back(e);
+        }
+        fclose(f);
+        return true;
+    }
+
+private:
+    static void putU16(uint8_t* p, uint16_t v) {
+        p[0] = v & 0xff;
+        p[1] = v >> 8;
+    }
+    static void putU32(uint8_t* p, uint32_t v) {
+        for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xff;
+    }
+    static uint16_t getU16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+    static uint32_t getU32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    FILE* file;
+    uint64_t lastUs;
+};
+
+// Time source for game state. Live play reads the wrapped clock (glfwGetTime
+// in the game); replay pins it to each recorded event's timestamp so that
+// everything derived from it comes out the same.
+class GameClock {
+public:
+    GameClock() : source(nullptr), fixed(0.0) {}
+
+    void useSource(double (*fn)()) { source = fn; }
+    void set(double t) {
+        source = nullptr;
+        fixed = t;
+    }
+    double now() const { return source ? source() : fixed; }
+
+private:
+    double (*source)();
+    double fixed;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Times in seconds.
+struct LatencySummary {
+    uint64_t count;     // samples ever added
+    double mean, p50, p99, max;
+};
+
+// The last `window` latency samples, summarised on demand. Its storage is
+// allocated up front, so adding and summarising never allocate and it can
+// be kept up to date from the frame loop.
+class LatencyStats {
+public:
+    explicit LatencyStats(std::size_t window = 1024) : samples(std::max<std::size_t>(window, 1)), sorted(samples.size()), next(0), total(0) {}
+
+    void add(double seconds) {
+        samples[next] = seconds;
+        next = (next + 1) % samples.size();
+        total++;
+    }
+
+    void clear() { next = total = 0; }
+    uint64_t count() const { return total; }
+
+    // Over the samples in the window; all zero without any.
+    LatencySummary summary() const {
+        LatencySummary s = {total, 0.0, 0.0, 0.0, 0.0};
+        std::size_t n = std::min<uint64_t>(total, samples.size());
+        if (n == 0) return s;
+        std::copy(samples.begin(), samples.begin() + n, sorted.begin());
+        std::sort(sorted.begin(), sorted.begin() + n);
+        double sum = 0.0;
+        for (std::size_t i = 0; i < n; i++) sum += sorted[i];
+        s.mean = sum / n;
+        s.p50 = sorted[n / 2];
+        s.p99 = sorted[std::min(n - 1, n * 99 / 100)];
+        s.max = sorted[n - 1];
+        return s;
+    }
+
+private:
+    std::vector<double> samples;
+    mutable std::vector<double> sorted;
+    std::size_t next;
+    uint64_t total;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef LIVE_POSITIONS_H
+#define LIVE_POSITIONS_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "peg_engine.h"
+
+// The positions on some line of jumps from a start position to a single peg
+// on a target cell, canonical up to the symmetries that fix the target. They
+// are found a peg count at a time, meeting in the middle: forward from the
+// start down to half its pegs, backward from the goal up to the same count,
+// and then out from the overlap. Ranks order them by peg count and then
+// value, and a hash index finds a position's rank in O(1).
+template <class Engine>
+class BasicLivePositions {
+public:
+    typedef typename Engine::Bits Bits;
+
+    // Called every PROGRESS_INTERVAL positions expanded with the count so
+    // far; returning false abandons find().
+    typedef std::function<bool(uint64_t)> Progress;
+    static const uint64_t PROGRESS_INTERVAL = 1 << 16;
+    static const std::size_t NONE = ~std::size_t(0);
+
+    explicit BasicLivePositions(const Engine& e) : engine(e), target(-1), start(0), expanded(0), aborted(false), slots(2, 0), shift(63) {}
+
+    // False, leaving the set empty, if cancelled or if finding them would
+    // hold more than maxPositions positions at once.
+    bool find(Bits startPegs, int targetCell, std::size_t maxPositions, const Progress& progress = Progress()) {
+        onProgress = progress;
+        expanded = 0;
+        aborted = false;
+        target = targetCell;
+        start = startPegs;
+        stabilizer.clear();
+        for (int s = 1; s < engine.numSymmetries(); s++)
+            if (engine.symmetryCell(s, target) == target) stabilizer.push_back(s);
+        positions.clear();
+        layers.clear();
+        slots.clear();
+        std::vector<std::vector<Bits>> live;
+        bool ok = findLayers(maxPositions, live);
+        index(live);
+        return ok;
+    }
+
+    int targetCell() const { return target; }
+    Bits startPosition() const { return start; }
+    uint64_t expandedCount() const { return expanded; }
+    bool cancelled() const { return aborted; }
+    std::size_t size() const { return positions.size(); }
+    std::size_t bytes() const { return positions.size() * sizeof(Bits) + slots.size() * sizeof(uint32_t); }
+
+    Bits canonical(Bits pegs) const {
+        Bits best = pegs;
+        for (std::size_t i = 0; i < stabilizer.size(); i++) {
+            Bits p = engine.transform(pegs, stabilizer[i]);
+            if (p < best) best = p;
+        }
+        return best;
+    }
+
+    // Ranks layerBegin(n) up to layerBegin(n + 1) hold the positions with n
+    // pegs.
+    std::size_t layerBegin(int n) const { return n < static_cast<int>(layers.size()) ? layers[n] : positions.size(); }
+    Bits position(std::size_t rank) const { return positions[rank]; }
+
+    // Rank of a canonical position, or NONE if it isn't live.
+    std::size_t rank(Bits key) const {
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = slot(key); slots[i]; i = (i + 1) & mask)
+            if (positions[slots[i] - 1] == key) return slots[i] - 1;
+        return NONE;
+    }
+
+private:
+    static const std::size_t COMPACT = 1 << 22;  // unsorted children before a sort pass
+
+    std::size_t slot(Bits key) const { return (uint64_t(std::hash<Bits>()(key)) * 0x9E3779B97F4A7C15ULL) >> shift; }
+
+    // Sorts the tail of out from sorted on and merges it into the head.
+    static std::size_t compact(std::vector<Bits>& out, std::size_t sorted) {
+        std::sort(out.begin() + sorted, out.end());
+        std::inplace_merge(out.begin(), out.begin() + sorted, out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out.size();
+    }
+
+    // Positions one jump after (or before, going backward) those in from,
+    // canonical, sorted and unique. A jump can be undone exactly when it
+    // could be played on the complement of the position.
+    void expand(const std::vector<Bits>& from, bool backward, std::vector<Bits>& out) {
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        std::size_t sorted = 0;
+        out.clear();
+        for (std::size_t i = 0; i < from.size() && !aborted; i++) {
+            int n = engine.generateMoves(backward ? engine.fullBoard() ^ from[i] : from[i], moves);
+            for (int k = 0; k < n; k++) out.push_back(canonical(from[i] ^ engine.jumps()[moves[k]].flip));
+            if (out.size() - sorted > COMPACT) sorted = compact(out, sorted);
+            if ((++expanded % PROGRESS_INTERVAL) == 0 && onProgress && !onProgress(expanded)) aborted = true;
+        }
+        compact(out, sorted);
+    }
+
+    // Keeps the positions of layer that are also in other.
+    static void intersect(std::vector<Bits>& layer, const std::vector<Bits>& other) {
+        std::vector<Bits> out;
+        std::set_intersection(layer.begin(), layer.end(), other.begin(), other.end(), std::back_inserter(out));
+        layer.swap(out);
+    }
+
+    bool findLayers(std::size_t maxPositions, std::vector<std::vector<Bits>>& live) {
+        int top = pegCount(start), mid = (top + 1) / 2;
+        live.assign(top + 1, std::vector<Bits>());
+        if (mid == 0) return true;
+        std::vector<std::vector<Bits>> back(mid + 1);
+        std::vector<Bits> scratch;
+        live[top].push_back(canonical(start));
+        back[1].push_back(canonical(Engine::bit(target)));
+        std::size_t total = 2;
+        for (int n = top; n > mid && total <= maxPositions && !aborted; n--) {
+            expand(live[n], false, live[n - 1]);
+            total += live[n - 1].size();
+        }
+        for (int n = 1; n < mid && total <= maxPositions && !aborted; n++) {
+            expand(back[n], true, back[n + 1]);
+            total += back[n + 1].size();
+        }
+        if (aborted || total > maxPositions) {
+            live.clear();
+            return false;
+        }
+        intersect(live[mid], back[mid]);
+        for (int n = mid + 1; n <= top && !aborted; n++) {
+            expand(live[n - 1], true, scratch);
+            intersect(live[n], scratch);
+        }
+        for (int n = mid - 1; n >= 1 && !aborted; n--) {
+            expand(live[n + 1], false, scratch);
+            intersect(back[n], scratch);
+            live[n].swap(back[n]);
+        }
+        if (aborted) live.clear();
+        return !aborted;
+    }
+
+    void index(std::vector<std::vector<Bits>>& live) {
+        for (std::size_t n = 0; n < live.size(); n++) {
+            layers.push_back(positions.size());
+            positions.insert(positions.end(), live[n].begin(), live[n].end());
+            std::vector<Bits>().swap(live[n]);
+        }
+        std::size_t n = 2;
+        for (shift = 63; n < 2 * positions.size(); shift--) n *= 2;
+        slots.assign(n, 0);
+        for (std::size_t r = 0; r < positions.size(); r++) {
+            std::size_t i = slot(positions[r]);
+            while (slots[i]) i = (i + 1) & (n - 1);
+            slots[i] = static_cast<uint32_t>(r + 1);
+        }
+    }
+
+    const Engine& engine;
+    int target;
+    Bits start;
+    uint64_t expanded;
+    bool aborted;
+    Progress onProgress;
+    std::vector<int> stabilizer;    // symmetries other than the identity that fix target
+    std::vector<Bits> positions;    // by rank
+    std::vector<std::size_t> layers;    // first rank of each peg count
+    std::vector<uint32_t> slots;    // rank + 1, 0 when empty
+    int shift;                      // 64 - log2(slots.size())
+};
+
+typedef BasicLivePositions<PegEngine> LivePositions;
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef MOVE_HISTORY_H
+#define MOVE_HISTORY_H
+
+#include <cstddef>
+#include <vector>
+
+// The positions and jump indices of a game from its start, with the ones
+// undone kept for redo until the next jump is played. reserve() sizes it for
+// a board up front, so playing, undoing and redoing never allocate.
+template <class Bits>
+class MoveHistory {
+public:
+    // jumps: the most a game can have, one fewer than the board's holes.
+    void reserve(std::size_t jumps) {
+        positions.reserve(jumps + 1);
+        undone.reserve(jumps + 1);
+        moves.reserve(jumps);
+        undoneMoves.reserve(jumps);
+    }
+
+    void reset(Bits start) {
+        clear();
+        positions.push_back(start);
+    }
+
+    // Forgets the game, start included.
+    void clear() {
+        positions.clear();
+        undone.clear();
+        moves.clear();
+        undoneMoves.clear();
+    }
+
+    void play(Bits after, int jump) {
+        positions.push_back(after);
+        moves.push_back(jump);
+        undone.clear();
+        undoneMoves.clear();
+    }
+
+    // False at the start; current() is then the position before the jump.
+    bool undo() {
+        if (positions.size() <= 1) return false;
+        undone.push_back(positions.back());
+        positions.pop_back();
+        undoneMoves.push_back(moves.back());
+        moves.pop_back();
+        return true;
+    }
+
+    // False with nothing undone; the jump redone is then played().back().
+    bool redo() {
+        if (undone.empty()) return false;
+        positions.push_back(undone.back());
+        undone.pop_back();
+        moves.push_back(undoneMoves.back());
+        undoneMoves.pop_back();
+        return true;
+    }
+
+    Bits current() const { return positions.back(); }
+    // Jump indices from the start to the current position.
+    const std::vector<int>& played() const { return moves; }
+
+private:
+    std::vector<Bits> positions;    // from the start to the current one
+    std::vector<Bits> undone;
+    std::vector<int> moves;
+    std::vector<int> undoneMoves;
+};
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef MOVE_SOLVER_H
+#define MOVE_SOLVER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "live_positions.h"
+#include "peg_engine.h"
+#include "position_file.h"
+#include "transposition_table.h"
+
+// Counts moves the way competitive play scores them: consecutive jumps by the
+// same peg are one move.
+template <class Engine>
+int countMoves(const Engine& e, const std::vector<int>& jumps) {
+    int moves = 0, last = -1;
+    for (std::size_t i = 0; i < jumps.size(); i++) {
+        const typename Engine::Jump& j = e.jumps()[jumps[i]];
+        if (j.from != last) moves++;
+        last = j.to;
+    }
+    return moves;
+}
+
+// IDA* for the fewest moves that leave a single peg on the target cell. Each
+// node is a position between moves; its children are every position one run
+// of jumps by a single peg away. Positions are canonical up to the symmetries
+// that fix the target.
+//
+// Before searching, the live positions (see live_positions.h) each get their
+// exact distance to the goal, which makes the bound exact and the search a
+// straight walk down an optimal line. When they don't fit in LIVE_BYTES the
+// bound falls back to counting full Merson regions (see lowerBound()),
+// raised by a transposition table of bounds learned in earlier iterations
+// (transposition_table.h). A bound stored with more moves left below it is
+// kept over a smaller one, and entries from earlier iterations give way
+// first.
+//
+// That bounded search can run for hours, so it can checkpoint: every interval
+// it saves the table and the bound it is on, and a later solve of the same
+// position resumes the iteration at that bound with the table it had built.
+template <class Engine>
+class BasicMinMoveSolver {
+public:
+    typedef typename Engine::Bits Bits;
+    typedef typename Engine::Jump Jump;
+
+    // Called every PROGRESS_INTERVAL nodes and at the start of each iteration
+    // with the current move bound (0 while the live positions are being
+    // found); returning false abandons the search.
+    typedef std::function<bool(int, uint64_t)> Progress;
+    static const uint64_t PROGRESS_INTERVAL = 1 << 16;
+    static const std::size_t TABLE_BYTES = std::size_t(128) << 20;
+    static const std::size_t LIVE_BYTES = std::size_t(512) << 20;
+
+    explicit BasicMinMoveSolver(const Engine& e, std::size_t tableBytes = TABLE_BYTES, std::size_t liveBytes = LIVE_BYTES)
+        : engine(e), live(e), maxLive(liveBytes / sizeof(Bits)), exact(false), target(-1), nodeCount(0), aborted(false), table(tableBytes),
+          resuming(false) {
+        byFrom.resize(e.numCells());
+        for (int k = 0; k < e.numJumps(); k++) byFrom[e.jumps()[k].from].push_back(k);
+        findRegions();
+    }
+
+    // Checkpoints the bounded search to path (a state file, plus path.table)
+    // every interval seconds; with resume, solve() first looks there for a
+    // checkpoint of the same problem.
+    void setCheckpoint(const std::string& path, double intervalSeconds, bool resume) {
+        checkpointPath = path;
+        clock = CheckpointClock(intervalSeconds);
+        resuming = resume;
+    }
+
+    uint64_t checkpoints() const { return clock.checkpoints(); }
+    double checkpointSeconds() const { return clock.totalSeconds(); }
+
+    // Minimum move count, or -1 if the target can't be reached (or the
+    // search was cancelled, in which case cancelled() is true).
+    int solve(Bits pegs, int targetCell, const Progress& progress = Progress()) {
+        onProgress = progress;
+        nodeCount = 0;
+        aborted = false;
+        line.clear();
+        path.clear();
+        if (targetCell != target || pegs != start) {
+            target = targetCell;
+            start = pegs;
+            goal = Engine::bit(target);
+            table.clear();
+            exact = live.find(pegs, target, maxLive, [&](uint64_t n) {
+                nodeCount = n;
+                return !onProgress || onProgress(0, n);
+            });
+            if (exact) findDistances();
+            if (live.cancelled() || aborted) {
+                aborted = true;
+                target = -1;
+                return -1;
+            }
+        }
+        int bound = exact ? distance(live.canonical(pegs)) : lowerBound(pegs);
+        if (!exact && resuming) bound = std::max(bound, loadCheckpoint());
+        while (bound < INF) {
+            if (onProgress && !onProgress(bound, nodeCount)) aborted = true;
+            if (aborted) return -1;
+            table.newSearch();
+            int next = search(pegs, 0, bound);
+            if (next == FOUND) {
+                removeCheckpoint();
+                return bound;
+            }
+            if (aborted) return -1;
+            bound = next;
+        }
+        removeCheckpoint();
+        return -1;
+    }
+
+    // Jump indices of the line found by the last successful solve().
+    const std::vector<int>& solution() const { return line; }
+    uint64_t nodes() const { return nodeCount; }
+    bool cancelled() const { return aborted; }
+    const TranspositionTable<Bits>& transpositions() const { return table; }
+
+private:
+    static const int INF = 0xff;
+    static const int FOUND = -1;
+
+    // A region is closed when every jump over one of its cells starts or
+    // lands inside it. While such a region is full nothing can jump into or
+    // over it, so some later move must start inside it.
+    bool closed(Bits region) const {
+        for (int k = 0; k < engine.numJumps(); k++) {
+            const Jump& j = engine.jumps()[k];
+            if ((region & Engine::bit(j.over)) && !(region & (Engine::bit(j.from) | Engine::bit(j.to)))) return false;
+        }
+        return true;
+    }
+
+    // Picks disjoint closed regions of up to MAX_REGION neighbouring cells,
+    // smallest first.
+    void findRegions() {
+        static const int MAX_REGION = 4;
+        GridSteps steps = gridSteps(engine.grid(), engine.rules());
+        std::vector<Bits> grown, found;
+        for (int i = 0; i < engine.numCells(); i++) grown.push_back(Engine::bit(i));
+        Bits used = 0;
+        for (int size = 1; size <= MAX_REGION && !grown.empty(); size++) {
+            std::vector<Bits> next;
+            for (std::size_t r = 0; r < grown.size(); r++) {
+                Bits region = grown[r];
+                bool minimal = true;
+                for (std::size_t f = 0; f < found.size() && minimal; f++) minimal = (found[f] & region) != found[f];
+                if (!minimal) continue;
+                if (closed(region)) {
+                    found.push_back(region);
+                    if (!(used & region)) {
+                        regions.push_back(region);
+                        used |= region;
+                    }
+                    continue;
+                }
+                for (int i = 0; i < engine.numCells(); i++) {
+                    if (!(region & Engine::bit(i))) continue;
+                    for (int d = 0; d < steps.count; d++) {
+                        int c = engine.cellIndex(engine.cellRow(i) + steps.dRow[d], engine.cellCol(i) + steps.dCol[d]);
+                        if (c >= 0 && !(region & Engine::bit(c))) next.push_back(region | Engine::bit(c));
+                    }
+                }
+            }
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            grown.swap(next);
+        }
+    }
+
+    // Full closed regions each need a move of their own; a position other
+    // than the goal needs at least one.
+    int lowerBound(Bits pegs) const {
+        if (pegs == goal) return 0;
+        int h = 0;
+        for (std::size_t i = 0; i < regions.size(); i++) h += (pegs & regions[i]) == regions[i] && regions[i] != goal;
+        return h > 0 ? h : 1;
+    }
+
+    bool tick(int bound) {
+        if ((++nodeCount % PROGRESS_INTERVAL) == 0) {
+            if (onProgress && !onProgress(bound, nodeCount)) aborted = true;
+            if (bound && !exact && clock.due()) saveCheckpoint(bound);
+        }
+        return !aborted;
+    }
+
+    std::string startText() const {
+        std::string text(engine.numCells(), '0');
+        for (int i = 0; i < engine.numCells(); i++)
+            if (start & Engine::bit(i)) text[i] = '1';
+        return text;
+    }
+
+    // The table goes first; the state naming its bound only replaces the old
+    // one once the table is safely on disk.
+    void saveCheckpoint(int bound) {
+        clock.begin();
+        PositionWriter<TableEntry> w;
+        bool ok = w.open(checkpointPath + ".table");
+        for (std::size_t i = 0; ok && i < table.entries(); i++) w.put(table.entry(i));
+        CheckpointState c;
+        c.set("start", startText());
+        c.setInt("target", target);
+        c.setInt("entries", static_cast<int64_t>(table.entries()));
+        c.setInt("age", table.currentAge());
+        c.setInt("bound", bound);
+        c.setInt("nodes", static_cast<int64_t>(nodeCount));
+        clock.store(c);
+        ok = ok && w.commit(true) && c.save(checkpointPath);
+        clock.end();
+        if (!ok) fprintf(stderr, "Error writing checkpoint: '%s'\n", checkpointPath.c_str());
+    }
+
+    void removeCheckpoint() {
+        if (!clock.enabled() || exact) return;
+        unlink(checkpointPath.c_str());
+        unlink((checkpointPath + ".table").c_str());
+    }
+
+    // The bound to resume at, with the table restored; 0 if there is no
+    // checkpoint of this problem.
+    int loadCheckpoint() {
+        resuming = false;
+        CheckpointState c;
+        PositionReader<TableEntry> r;
+        if (!c.load(checkpointPath) || c.get("start") != startText() || c.getInt("target", -1) != target ||
+            c.getInt("entries") != static_cast<int64_t>(table.entries()) || !r.open(checkpointPath + ".table") || r.size() != table.entries())
+            return 0;
+        TableEntry t;
+        for (std::size_t i = 0; i < table.entries() && r.next(t); i++) table.setEntry(i, t);
+        table.setAge(static_cast<uint8_t>(c.getInt("age")));
+        clock.restore(c);
+        nodeCount = c.getInt("nodes");
+        return static_cast<int>(c.getInt("bound"));
+    }
+
+    // From the goal up: a live position is one move further than the best
+    // position any run of jumps from it ends on.
+    void findDistances() {
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        distances.assign(live.size(), INF);
+        for (std::size_t r = live.layerBegin(1); r < live.layerBegin(2); r++) distances[r] = 0;
+        for (std::size_t r = live.layerBegin(2); r < live.size() && tick(0); r++) {
+            Bits pegs = live.position(r);
+            int best = INF, count = engine.generateMoves(pegs, moves);
+            for (int k = 0; k < count; k++) {
+                const Jump& j = engine.jumps()[moves[k]];
+                best = std::min(best, runDistance(pegs ^ j.flip, j.to));
+            }
+            distances[r] = static_cast<uint8_t>(best < INF ? best + 1 : INF);
+        }
+    }
+
+    int runDistance(Bits pegs, int cell) const {
+        int best = distance(live.canonical(pegs));
+        const std::vector<int>& next = byFrom[cell];
+        for (std::size_t i = 0; i < next.size(); i++)
+            if (engine.isLegal(pegs, next[i])) best = std::min(best, runDistance(pegs ^ engine.jumps()[next[i]].flip, engine.jumps()[next[i]].to));
+        return best;
+    }
+
+    // Exact moves left from a canonical live position; INF for any other.
+    int distance(Bits key) const {
+        std::size_t r = live.rank(key);
+        return r == BasicLivePositions<Engine>::NONE ? INF : distances[r];
+    }
+
+    // Returns FOUND, or the smallest f = g + h above bound seen below pegs.
+    int search(Bits pegs, int g, int bound) {
+        if (pegs == goal) {
+            line = path;
+            return FOUND;
+        }
+        if (!tick(bound)) return INF;
+        Bits key = live.canonical(pegs);
+        int h = exact ? distance(key) : lowerBound(pegs);
+        int stored, depth;
+        if (!exact && table.probe(key, stored, depth) && stored > h) h = stored;
+        if (h >= INF) return INF;
+        if (g + h > bound) return g + h;
+        int best = INF;
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        int n = engine.generateMoves(pegs, moves);
+        for (int i = 0; i < n; i++) {
+            int f = run(pegs, moves[i], g + 1, bound);
+            if (f == FOUND) return FOUND;
+            if (f < best) best = f;
+            if (aborted) return INF;
+        }
+        // Everything below needs at least best - g more moves, and the
+        // search proving it went bound - g moves deep.
+        if (!exact) table.store(key, best - g < INF ? best - g : INF, bound - g);
+        return best;
+    }
+
+    // Plays jump k as part of the current move, then either ends the move or
+    // continues it with the same peg.
+    int run(Bits pegs, int k, int g, int bound) {
+        const Jump& j = engine.jumps()[k];
+        pegs ^= j.flip;
+        path.push_back(k);
+        int best = search(pegs, g, bound);
+        const std::vector<int>& next = byFrom[j.to];
+        for (std::size_t i = 0; i < next.size() && best != FOUND && !aborted; i++) {
+            if (!engine.isLegal(pegs, next[i])) continue;
+            int f = run(pegs, next[i], g, bound);
+            if (f < best) best = f;
+        }
+        path.pop_back();
+        return best;
+    }
+
+    const Engine& engine;
+    BasicLivePositions<Engine> live;
+    std::size_t maxLive;
+    bool exact;                     // live positions found: distances hold the exact bound
+    std::vector<uint8_t> distances; // moves left, by live rank
+    int target;
+    Bits start, goal;
+    std::vector<Bits> regions;      // disjoint closed regions
+    uint64_t nodeCount;
+    bool aborted;
+    Progress onProgress;
+    std::vector<std::vector<int>> byFrom;   // jump indices by starting cell
+    TranspositionTable<Bits> table;
+    std::vector<int> path, line;
+    std::string checkpointPath;
+    CheckpointClock clock;
+    bool resuming;
+};
+
+typedef BasicMinMoveSolver<PegEngine> MinMoveSolver;
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef PEG_ENGINE_H
+#define PEG_ENGINE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "wide_bits.h"
+
+// Bitboard position: bit i is set when cell i (dense, row-major over the
+// valid cells of the layout) holds a peg. Boards with more than 64 cells use
+// WideBits instead.
+typedef uint64_t PegBits;
+
+inline PegBits pegBit(int i) { return PegBits(1) << i; }
+inline int pegCount(PegBits b) { return __builtin_popcountll(b); }
+inline int pegLowest(PegBits b) { return __builtin_ctzll(b); }
+inline int lowByte(PegBits b) { return static_cast<int>(b & 0xff); }
+inline uint64_t lowWord(PegBits b) { return b; }
+
+enum BoardGrid {
+    GRID_SQUARE = 0,    // jumps along rows and columns
+    GRID_HEX            // triangular lattice: rows, columns and the (1, 1) diagonal
+};
+
+// Rule sets for the square grid; the hex grid always has its six directions.
+enum JumpRules {
+    RULES_ORTHOGONAL = 0,
+    RULES_DIAGONAL      // diagonal jumps allowed too: eight directions
+};
+
+// Unit steps between neighbouring cells of a grid; a jump is two steps. On
+// the hex grid, cell (r, c) sits at x = c - r / 2, y = r * sqrt(3) / 2.
+struct GridSteps {
+    static const int MAX_DIRECTIONS = 8;
+    int count;
+    int dRow[MAX_DIRECTIONS], dCol[MAX_DIRECTIONS];
+};
+
+constexpr GridSteps gridSteps(int grid, int rules = RULES_ORTHOGONAL) {
+    return grid == GRID_HEX              ? GridSteps{6, {-1, 1, 0, 0, -1, 1}, {0, 0, -1, 1, -1, 1}}
+           : rules == RULES_DIAGONAL     ? GridSteps{8, {-1, 1, 0, 0, -1, 1, -1, 1}, {0, 0, -1, 1, -1, 1, 1, -1}}
+                                         : GridSteps{4, {-1, 1, 0, 0}, {0, 0, -1, 1}};
+}
+
+// Linear part of symmetry s of a grid about the origin. Square: bit 0
+// mirrors columns, bit 1 mirrors rows, bit 2 transposes. Hex: s % 6
+// rotations by 60 degrees, after a mirror when s >= 6.
+constexpr int gridSymmetries(int grid) { return grid == GRID_HEX ? 12 : 8; }
+
+constexpr void gridSymmetry(int grid, int s, int r, int c, int& tr, int& tc) {
+    if (grid == GRID_HEX) {
+        if (s >= 6) c = r - c;
+        for (int k = 0; k < s % 6; k++) {
+            int t = r;
+            r = c;
+            c = c - t;
+        }
+    }
+    else {
+        if (s & 1) c = -c;
+        if (s & 2) r = -r;
+        if (s & 4) {
+            int t = r;
+            r = c;
+            c = t;
+        }
+    }
+    tr = r;
+    tc = c;
+}
+
+template <class B>
+struct BasicPegJump {
+    int from, over, to;
+    B need;         // from and over must hold pegs
+    B flip;         // from, over and to all toggle when the jump is played
+};
+
+// Move generator for a peg solitaire board. Positions are plain bit sets, so
+// applying and undoing a jump are the same XOR with jump.flip.
+template <class B>
+class BasicPegEngine {
+public:
+    typedef B Bits;
+    typedef BasicPegJump<B> Jump;
+    static const int MAX_CELLS = 8 * sizeof(B);
+
+    typedef int (*GenerateFn)(B, int*);
+    typedef bool (*HasMovesFn)(B);
+
+    BasicPegEngine() : nRows(0), nCols(0), nGrid(GRID_SQUARE), nRules(RULES_ORTHOGONAL), nCells(0), allCells(0), nSyms(0), nBytes(0), generateKernel(nullptr), hasMovesKernel(nullptr) {}
+
+    BasicPegEngine(int rows, int cols, const std::vector<bool>& valid, int grid = GRID_SQUARE, int rules = RULES_ORTHOGONAL)
+        : nRows(rows), nCols(cols), nGrid(grid), nRules(grid == GRID_HEX ? RULES_ORTHOGONAL : rules), nCells(0), allCells(0), nSyms(0), nBytes(0), generateKernel(nullptr), hasMovesKernel(nullptr) {
+        index.assign(rows * cols, -1);
+        for (int r = 0; r < rows; r++)
+            for (int c = 0; c < cols; c++) {
+                if (!valid[r * cols + c] || nCells == MAX_CELLS) continue;
+                index[r * cols + c] = nCells;
+                cellRows.push_back(r);
+                cellCols.push_back(c);
+                allCells |= bit(nCells++);
+            }
+        GridSteps steps = gridSteps(nGrid, nRules);
+        for (int i = 0; i < nCells; i++)
+            for (int k = 0; k < steps.count; k++) {
+                int over = cellIndex(cellRows[i] + steps.dRow[k], cellCols[i] + steps.dCol[k]);
+                int to = cellIndex(cellRows[i] + 2 * steps.dRow[k], cellCols[i] + 2 * steps.dCol[k]);
+                if (over < 0 || to < 0) continue;
+                Jump j;
+                j.from = i;
+                j.over = over;
+                j.to = to;
+                j.need = bit(i) | bit(over);
+                j.flip = j.need | bit(to);
+                jumpTable.push_back(j);
+                toBits.push_back(bit(to));
+            }
+        buildSymmetries();
+    }
+
+    static B bit(int i) { return B(1) << i; }
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+    int grid() const { return nGrid; }
+    int rules() const { return nRules; }
+    int numCells() const { return nCells; }
+    B fullBoard() const { return allCells; }
+    int cellRow(int i) const { return cellRows[i]; }
+    int cellCol(int i) const { return cellCols[i]; }
+
+    int cellIndex(int r, int c) const {
+        if (r < 0 || r >= nRows || c < 0 || c >= nCols) return -1;
+        return index[r * nCols + c];
+    }
+
+    const std::vector<Jump>& jumps() const { return jumpTable; }
+    int numJumps() const { return static_cast<int>(jumpTable.size()); }
+
+    int findJump(int sr, int sc, int dr, int dc) const {
+        int from = cellIndex(sr, sc), to = cellIndex(dr, dc);
+        if (from < 0 || to < 0) return -1;
+        for (std::size_t k = 0; k < jumpTable.size(); k++)
+            if (jumpTable[k].from == from && jumpTable[k].to == to) return static_cast<int>(k);
+        return -1;
+    }
+
+    bool isLegal(B pegs, int k) const {
+        const Jump& j = jumpTable[k];
+        return ((pegs ^ toBits[k]) & j.flip) == j.flip;
+    }
+
+    // Replaces the table-driven loops of generateMoves() and hasMoves() with
+    // code compiled for this layout (see static_engine.h).
+    void useKernels(GenerateFn generate, HasMovesFn has) {
+        generateKernel = generate;
+        hasMovesKernel = has;
+    }
+    bool specialised() const { return generateKernel != nullptr; }
+
+    // Writes the indices of all legal jumps into out (which must hold
+    // numJumps() entries) and returns how many there are.
+    int generateMoves(B pegs, int* out) const {
+        if (generateKernel) return generateKernel(pegs, out);
+        int n = 0;
+        for (std::size_t k = 0; k < jumpTable.size(); k++) {
+            const Jump& j = jumpTable[k];
+            out[n] = static_cast<int>(k);
+            n += ((pegs ^ toBits[k]) & j.flip) == j.flip;
+        }
+        return n;
+    }
+
+    bool hasMoves(B pegs) const {
+        if (hasMovesKernel) return hasMovesKernel(pegs);
+        for (std::size_t k = 0; k < jumpTable.size(); k++) {
+            const Jump& j = jumpTable[k];
+            if (((pegs ^ toBits[k]) & j.flip) == j.flip) return true;
+        }
+        return false;
+    }
+
+    B apply(B pegs, int k) const { return pegs ^ jumpTable[k].flip; }
+
+    bool isWin(B pegs, int target) const { return pegs == bit(target); }
+
+    // Rotations and reflections of the grid that map the layout onto itself;
+    // symmetry 0 is the identity and the rest keep gridSymmetry()'s order.
+    int numSymmetries() const { return nSyms; }
+    int symmetryCell(int s, int i) const { return symCells[s * nCells + i]; }
+
+    // Image of a position under symmetry s, one table lookup per byte.
+    B transform(B pegs, int s) const {
+        const B* t = &symBytes[s * nBytes * 256];
+        B out = 0;
+        for (int b = 0; b < nBytes && pegs; b++, pegs = pegs >> 8) out |= t[b * 256 + lowByte(pegs)];
+        return out;
+    }
+
+private:
+    void buildSymmetries() {
+        nSyms = 0;
+        nBytes = (nCells + 7) / 8;
+        symCells.clear();
+        symBytes.clear();
+        if (nCells == 0) return;
+        // Each linear map is followed by the translation that takes the first
+        // image cell in row-major order back to cell 0.
+        std::vector<int> imageRows(nCells), imageCols(nCells);
+        for (int s = 0; s < gridSymmetries(nGrid); s++) {
+            int minRow = 0, minCol = 0;
+            for (int i = 0; i < nCells; i++) {
+                gridSymmetry(nGrid, s, cellRows[i], cellCols[i], imageRows[i], imageCols[i]);
+                if (i == 0 || imageRows[i] < minRow || (imageRows[i] == minRow && imageCols[i] < minCol)) {
+                    minRow = imageRows[i];
+                    minCol = imageCols[i];
+                }
+            }
+            std::vector<int> image(nCells);
+            bool ok = true;
+            for (int i = 0; i < nCells && ok; i++) {
+                image[i] = cellIndex(imageRows[i] - minRow + cellRows[0], imageCols[i] - minCol + cellCols[0]);
+                ok = image[i] >= 0;
+            }
+            if (!ok) continue;
+            symCells.insert(symCells.end(), image.begin(), image.end());
+            symBytes.resize((nSyms + 1) * nBytes * 256, B(0));
+            B* t = &symBytes[nSyms * nBytes * 256];
+            for (int b = 0; b < nBytes; b++)
+                for (int v = 0; v < 256; v++)
+                    for (int k = 0; k < 8; k++)
+                        if ((v >> k & 1) && b * 8 + k < nCells) t[b * 256 + v] |= bit(image[b * 8 + k]);
+            nSyms++;
+        }
+    }
+
+    int nRows, nCols, nGrid, nRules, nCells;
+    B allCells;
+    std::vector<int> index;
+    std::vector<int> cellRows, cellCols;
+    std::vector<Jump> jumpTable;
+    std::vector<B> toBits;          // bit(jump.to), parallel to jumpTable
+    int nSyms, nBytes;
+    std::vector<int> symCells;      // nSyms x nCells permutation
+    std::vector<B> symBytes;        // nSyms x nBytes x 256 values
+    GenerateFn generateKernel;
+    HasMovesFn hasMovesKernel;
+};
+
+typedef BasicPegEngine<PegBits> PegEngine;
+typedef BasicPegEngine<WideBits> WidePegEngine;
+typedef PegEngine::Jump PegJump;
+
+#endif
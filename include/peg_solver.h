@@ -0,0 +1,172 @@
+#ifndef PEG_SOLVER_H
+#define PEG_SOLVER_H
+
+#include <stdint.h>
+#include <functional>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+#include "arena.h"
+#include "peg_engine.h"
+
+enum SolveStatus {
+    SOLVE_UNKNOWN,      // not finished (or cancelled)
+    SOLVE_WINNABLE,
+    SOLVE_LOST
+};
+
+// Depth-first search for a sequence of jumps that leaves a single peg on the
+// target cell. Positions proven lost are memoised up to the board symmetries
+// that fix the target; the memo is kept between solves for the same target
+// and is simply dropped when it grows past maxDeadEntries, which by default
+// keeps it near MEMO_BYTES whatever the position width.
+//
+// The memo lives in an arena (arena.h) that is reset whenever the memo is
+// dropped, so a search allocates nothing from the heap once the solver has
+// held its largest memo.
+template <class Engine>
+class BasicPegSolver {
+public:
+    typedef typename Engine::Bits Bits;
+    typedef typename Engine::Jump Jump;
+
+    // Called every PROGRESS_INTERVAL nodes with the running node count;
+    // returning false abandons the search.
+    typedef std::function<bool(uint64_t)> Progress;
+    static const uint64_t PROGRESS_INTERVAL = 4096;
+    static const std::size_t MEMO_BYTES = std::size_t(160) << 20;
+
+    // Hash set node plus bucket, and the buckets outgrown on the way, roughly.
+    static std::size_t defaultMaxDead() { return MEMO_BYTES / (sizeof(Bits) + 32); }
+
+    explicit BasicPegSolver(const Engine& e, std::size_t maxDeadEntries = defaultMaxDead())
+        : engine(e), maxDead(maxDeadEntries), target(-1), nodeCount(0), aborted(false), onProgress(nullptr) {
+        classMasks(e, classMask);
+        dropMemo();
+    }
+
+    SolveStatus solve(Bits pegs, int targetCell, const Progress& progress = Progress()) {
+        if (targetCell >= engine.numCells()) targetCell = -1;     // lost, like no target
+        if (targetCell != target) {
+            dropMemo();
+            target = targetCell;
+            stabilizer.clear();
+            for (int s = 1; s < engine.numSymmetries() && target >= 0; s++)
+                if (engine.symmetryCell(s, target) == target) stabilizer.push_back(s);
+        }
+        onProgress = progress ? &progress : nullptr;
+        nodeCount = 0;
+        aborted = false;
+        line.clear();
+        moveBuf.assign((engine.numCells() + 1) * engine.numJumps() + 1, 0);
+        if (target < 0 || positionClass(pegs) != positionClass(Engine::bit(target))) return SOLVE_LOST;
+        line.resize(pegCount(pegs));
+        if (search(pegs, 0)) {
+            line.resize(pegCount(pegs) - 1);
+            return SOLVE_WINNABLE;
+        }
+        line.clear();
+        return aborted ? SOLVE_UNKNOWN : SOLVE_LOST;
+    }
+
+    // Jump indices of the winning line found by the last successful solve().
+    const std::vector<int>& solution() const { return line; }
+    int bestMove() const { return line.empty() ? -1 : line[0]; }
+    uint64_t nodes() const { return nodeCount; }
+    // The memo's memory: peak() is the most it has held at once.
+    const Arena& memo() const { return arena; }
+
+    // Peg solitaire's position class: colour cells by (r + c) % 3 and by
+    // (r - c) % 3. A jump whose three cells get three different colours flips
+    // the parity of each colour count, so the pairwise parities are invariant
+    // and must match the goal's. A colouring that some jump of the engine
+    // doesn't respect (r - c along the hex diagonal) is left out.
+    int positionClass(Bits pegs) const { return positionClass(pegs, classMask); }
+
+    static int positionClass(Bits pegs, const Bits masks[2][3]) {
+        int cls = 0;
+        for (int k = 0; k < 2; k++) {
+            int n0 = pegCount(pegs & masks[k][0]);
+            int n1 = pegCount(pegs & masks[k][1]);
+            int n2 = pegCount(pegs & masks[k][2]);
+            cls = (cls << 2) | (((n0 ^ n1) & 1) << 1) | ((n1 ^ n2) & 1);
+        }
+        return cls;
+    }
+
+    static void classMasks(const Engine& e, Bits masks[2][3]) {
+        for (int k = 0; k < 2; k++) {
+            int sign = k == 0 ? 1 : -1;
+            bool valid = true;
+            for (int j = 0; j < e.numJumps() && valid; j++) {
+                const Jump& jump = e.jumps()[j];
+                int a = colour(e, jump.from, sign), b = colour(e, jump.over, sign), c = colour(e, jump.to, sign);
+                valid = a != b && b != c && a != c;
+            }
+            for (int c = 0; c < 3; c++) masks[k][c] = 0;
+            for (int i = 0; i < e.numCells() && valid; i++) masks[k][colour(e, i, sign)] |= Engine::bit(i);
+        }
+    }
+
+private:
+    typedef std::unordered_set<Bits, std::hash<Bits>, std::equal_to<Bits>, ArenaAllocator<Bits>> DeadSet;
+
+    // The set goes before the arena holding it is reset.
+    void dropMemo() {
+        dead.reset();
+        arena.reset();
+        dead.emplace(0, std::hash<Bits>(), std::equal_to<Bits>(), ArenaAllocator<Bits>(&arena));
+    }
+
+    static int colour(const Engine& e, int cell, int sign) {
+        return ((e.cellRow(cell) + sign * e.cellCol(cell)) % 3 + 3) % 3;
+    }
+
+    Bits canonical(Bits pegs) const {
+        Bits best = pegs;
+        for (std::size_t i = 0; i < stabilizer.size(); i++) {
+            Bits p = engine.transform(pegs, stabilizer[i]);
+            if (p < best) best = p;
+        }
+        return best;
+    }
+
+    bool search(Bits pegs, int depth) {
+        if (pegs == Engine::bit(target)) return true;
+        if ((++nodeCount % PROGRESS_INTERVAL) == 0 && onProgress && !(*onProgress)(nodeCount)) aborted = true;
+        if (aborted) return false;
+        Bits key = canonical(pegs);
+        if (dead->count(key)) return false;
+        int* moves = &moveBuf[depth * engine.numJumps()];
+        int n = engine.generateMoves(pegs, moves);
+        const std::vector<Jump>& jumps = engine.jumps();
+        for (int i = 0; i < n; i++) {
+            if (search(pegs ^ jumps[moves[i]].flip, depth + 1)) {
+                line[depth] = moves[i];
+                return true;
+            }
+            if (aborted) return false;
+        }
+        if (dead->size() >= maxDead) dropMemo();
+        dead->insert(key);
+        return false;
+    }
+
+    const Engine& engine;
+    std::size_t maxDead;
+    int target;
+    uint64_t nodeCount;
+    bool aborted;
+    const Progress* onProgress;     // during solve()
+    Bits classMask[2][3];
+    std::vector<int> stabilizer;    // symmetries other than the identity that fix target
+    Arena arena;
+    std::optional<DeadSet> dead;    // in arena
+    std::vector<int> moveBuf;
+    std::vector<int> line;
+};
+
+typedef BasicPegSolver<PegEngine> PegSolver;
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef PLAYOUT_H
+#define PLAYOUT_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "analysis.h"
+#include "peg_engine.h"
+
+enum PlayoutPolicy {
+    PLAYOUT_RANDOM,     // uniform over legal jumps
+    PLAYOUT_GUIDED      // prefer jumps that land next to other pegs
+};
+
+// xorshift64*: tiny, fast and good enough for move sampling.
+class PegRng {
+public:
+    explicit PegRng(uint64_t seed) : s(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+    uint64_t next() {
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+    int below(int n) { return static_cast<int>(((next() >> 32) * static_cast<uint64_t>(n)) >> 32); }
+
+private:
+    uint64_t s;
+};
+
+template <class Engine>
+struct BasicPlayoutTally {
+    uint64_t playouts;
+    uint64_t wins;
+    uint64_t pegsLeft[Engine::MAX_CELLS + 1];
+
+    BasicPlayoutTally() : playouts(0), wins(0) {
+        for (int i = 0; i <= Engine::MAX_CELLS; i++) pegsLeft[i] = 0;
+    }
+};
+
+template <class Engine>
+class BasicPlayoutRunner {
+public:
+    typedef typename Engine::Bits Bits;
+    typedef typename Engine::Jump Jump;
+
+    explicit BasicPlayoutRunner(const Engine& e) : engine(e), moves(e.numJumps() + 1) {
+        neighbours.assign(e.numCells(), 0);
+        for (int i = 0; i < e.numCells(); i++) {
+            int r = e.cellRow(i), c = e.cellCol(i);
+            GridSteps steps = gridSteps(e.grid(), e.rules());
+            for (int k = 0; k < steps.count; k++) {
+                int n = e.cellIndex(r + steps.dRow[k], c + steps.dCol[k]);
+                if (n >= 0) neighbours[i] |= Engine::bit(n);
+            }
+        }
+    }
+
+    // Plays one game to the end and returns the final position.
+    Bits play(Bits pegs, PlayoutPolicy policy, PegRng& rng) {
+        const std::vector<Jump>& jumps = engine.jumps();
+        for (;;) {
+            int n = engine.generateMoves(pegs, &moves[0]);
+            if (n == 0) return pegs;
+            int pick = rng.below(n);
+            if (policy == PLAYOUT_GUIDED && (rng.next() & 3) != 0) {
+                int best = -1;
+                for (int i = 0; i < n; i++) {
+                    const Jump& j = jumps[moves[i]];
+                    int score = pegCount((pegs ^ j.flip) & neighbours[j.to]);
+                    if (score > best || (score == best && (rng.next() & 1))) {
+                        best = score;
+                        pick = i;
+                    }
+                }
+            }
+            pegs ^= jumps[moves[pick]].flip;
+        }
+    }
+
+    void run(Bits start, int target, PlayoutPolicy policy, uint64_t count, PegRng& rng, BasicPlayoutTally<Engine>& tally) {
+        for (uint64_t i = 0; i < count; i++) {
+            Bits end = play(start, policy, rng);
+            tally.pegsLeft[pegCount(end)]++;
+            if (engine.isWin(end, target)) tally.wins++;
+        }
+        tally.playouts += count;
+    }
+
+private:
+    const Engine& engine;
+    std::vector<int> moves;
+    std::vector<Bits> neighbours;
+};
+
+// Runs batched playouts from the latest requested position on every core and
+// accumulates the results. request() and snapshot() are cheap enough to call
+// once per frame; a new request abandons the previous position's statistics.
+// Workers publish the totals through a seqlock after every batch, taking
+// turns as its writer, so snapshot() never waits on them.
+template <class Engine>
+class BasicDifficultyEstimator {
+public:
+    typedef typename Engine::Bits Bits;
+    static const uint64_t BATCH = 4096;
+
+    struct Snapshot {
+        uint64_t playouts;
+        uint64_t wins;
+        uint64_t pegsLeft[Engine::MAX_CELLS + 1];
+        double winRate() const { return playouts ? static_cast<double>(wins) / playouts : 0.0; }
+    };
+
+    BasicDifficultyEstimator() : engine(nullptr), policy(PLAYOUT_RANDOM), budget(4000000), stopping(false), current(0) {}
+    ~BasicDifficultyEstimator() { stop(); }
+
+    // A request made before the previous stop() belongs to the old engine
+    // and is dropped.
+    void start(const Engine* e, PlayoutPolicy p = PLAYOUT_RANDOM, uint64_t playoutBudget = 4000000) {
+        stop();
+        engine = e;
+        policy = p;
+        budget = playoutBudget;
+        stopping = false;
+        job = Job();
+        current = 0;
+        published.store(Snapshot());
+        unsigned n = std::thread::hardware_concurrency();
+        if (n == 0) n = 1;
+        for (unsigned i = 0; i < n; i++) workers.push_back(std::thread(&BasicDifficultyEstimator::workerLoop, this, i + 1));
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::size_t i = 0; i < workers.size(); i++) workers[i].join();
+        workers.clear();
+    }
+
+    void request(Bits pegs, int target) {
+        std::shared_ptr<SharedTally> t = std::make_shared<SharedTally>();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job.pegs = pegs;
+            job.target = target;
+            job.tally = t;
+            job.generation++;
+            std::lock_guard<std::mutex> turn(publishing);
+            current = job.generation;
+            published.store(Snapshot());
+        }
+        wake.notify_all();
+    }
+
+    Snapshot snapshot() const { return published.load(); }
+
+private:
+    struct SharedTally {
+        std::atomic<uint64_t> playouts;
+        std::atomic<uint64_t> wins;
+        std::atomic<uint64_t> pegsLeft[Engine::MAX_CELLS + 1];
+        std::atomic<uint64_t> claimed;
+
+        SharedTally() : playouts(0), wins(0), claimed(0) {
+            for (int i = 0; i <= Engine::MAX_CELLS; i++) pegsLeft[i] = 0;
+        }
+    };
+
+    struct Job {
+        Bits pegs;
+        int target;
+        uint64_t generation;
+        std::shared_ptr<SharedTally> tally;
+        Job() : pegs(0), target(0), generation(0) {}
+    };
+
+    void workerLoop(uint64_t seed) {
+        BasicPlayoutRunner<Engine> runner(*engine);
+        PegRng rng(seed * 0x9E3779B97F4A7C15ULL);
+        for (;;) {
+            Job local;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || (job.tally && job.tally->claimed.load() < budget); });
+                if (stopping) return;
+                local = job;
+            }
+            // Claim the batch up front so the workers together stop at the budget.
+            if (local.tally->claimed.fetch_add(BATCH) >= budget) continue;
+            BasicPlayoutTally<Engine> tally;
+            runner.run(local.pegs, local.target, policy, BATCH, rng, tally);
+            for (int i = 0; i <= Engine::MAX_CELLS; i++)
+                if (tally.pegsLeft[i]) local.tally->pegsLeft[i].fetch_add(tally.pegsLeft[i], std::memory_order_relaxed);
+            local.tally->wins.fetch_add(tally.wins, std::memory_order_relaxed);
+            local.tally->playouts.fetch_add(tally.playouts, std::memory_order_relaxed);
+            publish(local);
+        }
+    }
+
+    // Totals of a job still current; a worker that finishes a batch after
+    // the next request publishes nothing.
+    void publish(const Job& j) {
+        std::lock_guard<std::mutex> turn(publishing);
+        if (j.generation != current) return;
+        Snapshot s;
+        s.playouts = j.tally->playouts.load(std::memory_order_relaxed);
+        s.wins = j.tally->wins.load(std::memory_order_relaxed);
+        for (int i = 0; i <= Engine::MAX_CELLS; i++) s.pegsLeft[i] = j.tally->pegsLeft[i].load(std::memory_order_relaxed);
+        published.store(s);
+    }
+
+    const Engine* engine;
+    PlayoutPolicy policy;
+    uint64_t budget;
+    bool stopping;
+    Job job;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::thread> workers;
+    std::mutex publishing;              // the seqlock's writer; taken after mutex
+    uint64_t current;                   // generation published, under publishing
+    SeqlockSnapshot<Snapshot> published;
+};
+
+typedef BasicPlayoutTally<PegEngine> PlayoutTally;
+typedef BasicPlayoutRunner<PegEngine> PlayoutRunner;
+typedef BasicDifficultyEstimator<PegEngine> DifficultyEstimator;
+
+#endif
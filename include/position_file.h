@@ -0,0 +1,252 @@
+#ifndef POSITION_FILE_H
+#define POSITION_FILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Makes a rename into the directory of path durable.
+inline bool syncDirectory(const std::string& path) {
+    std::string dir = path.find('/') == std::string::npos ? "." : path.substr(0, path.rfind('/') + 1);
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Replaces a small file as a whole, durably.
+inline bool replaceFile(const std::string& path, const std::string& contents) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(contents.data(), 1, contents.size(), f) == contents.size();
+    ok = fflush(f) == 0 && ok;
+    ok = fsync(fileno(f)) == 0 && ok;
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) unlink(tmp.c_str());
+    return ok && syncDirectory(path);
+}
+
+// Files of positions stored as raw Bits back to back, read and written
+// strictly in order. Layer and run files are sorted and unique.
+//
+// A writer fills PATH.tmp and commit() renames it over PATH, so PATH is only
+// ever missing or complete; a durable commit also syncs the file and its
+// directory, so that survives a crash of the machine too.
+template <class Bits>
+class PositionWriter {
+public:
+    static const std::size_t CHUNK = 1 << 14;
+
+    PositionWriter() : f(nullptr), count(0), ok(false) {}
+    ~PositionWriter() { abort(); }
+
+    bool open(const std::string& p) {
+        abort();
+        path = p;
+        count = 0;
+        buffer.clear();
+        f = fopen((path + ".tmp").c_str(), "wb");
+        ok = f != nullptr;
+        if (!ok) fprintf(stderr, "Error creating position file: '%s.tmp'\n", path.c_str());
+        return ok;
+    }
+
+    void put(const Bits& b) {
+        buffer.push_back(b);
+        count++;
+        if (buffer.size() == CHUNK) flushBuffer();
+    }
+
+    bool commit(bool durable) {
+        if (!f) return false;
+        flushBuffer();
+        if (fflush(f) != 0) ok = false;
+        if (ok && durable && fsync(fileno(f)) != 0) ok = false;
+        if (fclose(f) != 0) ok = false;
+        f = nullptr;
+        std::string tmp = path + ".tmp";
+        if (ok && rename(tmp.c_str(), path.c_str()) != 0) ok = false;
+        if (ok && durable) ok = syncDirectory(path);
+        if (!ok) {
+            fprintf(stderr, "Error writing position file: '%s'\n", path.c_str());
+            unlink(tmp.c_str());
+        }
+        return ok;
+    }
+
+    // Drops an uncommitted file.
+    void abort() {
+        if (!f) return;
+        fclose(f);
+        f = nullptr;
+        unlink((path + ".tmp").c_str());
+    }
+
+    uint64_t size() const { return count; }
+
+private:
+    void flushBuffer() {
+        if (ok && !buffer.empty() && fwrite(buffer.data(), sizeof(Bits), buffer.size(), f) != buffer.size()) ok = false;
+        buffer.clear();
+    }
+
+    FILE* f;
+    std::string path;
+    std::vector<Bits> buffer;
+    uint64_t count;
+    bool ok;
+};
+
+template <class Bits>
+class PositionReader {
+public:
+    static const std::size_t CHUNK = 1 << 14;
+
+    PositionReader() : f(nullptr), count(0), at(0), filled(0), error(false) {}
+    ~PositionReader() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        struct stat st;
+        count = fstat(fileno(f), &st) == 0 ? st.st_size / sizeof(Bits) : 0;
+        buffer.resize(CHUNK);
+        at = filled = 0;
+        error = false;
+        return true;
+    }
+
+    // Skips to the index-th position.
+    bool seek(uint64_t index) {
+        at = filled = 0;
+        return f && fseeko(f, static_cast<off_t>(index * sizeof(Bits)), SEEK_SET) == 0;
+    }
+
+    // False at the end of the file or on a read error; failed() tells them
+    // apart.
+    bool next(Bits& b) {
+        if (at == filled) {
+            filled = f ? fread(buffer.data(), sizeof(Bits), CHUNK, f) : 0;
+            at = 0;
+            if (filled < CHUNK && f && ferror(f)) error = true;
+            if (filled == 0 || error) return false;
+        }
+        b = buffer[at++];
+        return true;
+    }
+
+    void close() {
+        if (f) fclose(f);
+        f = nullptr;
+    }
+
+    uint64_t size() const { return count; }
+    bool failed() const { return error; }
+
+private:
+    FILE* f;
+    std::vector<Bits> buffer;
+    uint64_t count;
+    std::size_t at, filled;
+    bool error;
+};
+
+// Sorts and dedupes buffer and writes it as a run file, durably only if a
+// checkpoint is to count on it.
+template <class Bits>
+bool writeRun(std::vector<Bits>& buffer, const std::string& path, bool durable) {
+    std::sort(buffer.begin(), buffer.end());
+    buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+    PositionWriter<Bits> w;
+    if (!w.open(path)) return false;
+    for (std::size_t i = 0; i < buffer.size(); i++) w.put(buffer[i]);
+    buffer.clear();
+    return w.commit(durable);
+}
+
+// Most run files one merge reads at once, each through its own CHUNK
+// buffer.
+static const std::size_t MERGE_FAN_IN = 64;
+
+// One k-way merge of sorted files into out, dropping duplicates and, when
+// keep is given, anything not also in keep.
+template <class Bits>
+bool mergeFiles(const std::string* files, std::size_t n, PositionReader<Bits>* keep, PositionWriter<Bits>& out) {
+    typedef std::pair<Bits, std::size_t> Head;
+    std::vector<PositionReader<Bits>> readers(n);
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (std::size_t i = 0; i < n; i++) {
+        Bits b;
+        if (!readers[i].open(files[i])) {
+            fprintf(stderr, "Error opening position file: '%s'\n", files[i].c_str());
+            return false;
+        }
+        if (readers[i].next(b)) heads.push(Head(b, i));
+    }
+    Bits kept = 0, last = 0;
+    bool haveKept = keep && keep->next(kept), any = false;
+    while (!heads.empty()) {
+        Head h = heads.top();
+        heads.pop();
+        Bits b;
+        if (readers[h.second].next(b)) heads.push(Head(b, h.second));
+        if (any && h.first == last) continue;
+        last = h.first;
+        any = true;
+        if (keep) {
+            while (haveKept && kept < h.first) haveKept = keep->next(kept);
+            if (!haveKept) break;
+            if (kept != h.first) continue;
+        }
+        out.put(h.first);
+    }
+    for (std::size_t i = 0; i < n; i++)
+        if (readers[i].failed()) {
+            fprintf(stderr, "Error reading position file: '%s'\n", files[i].c_str());
+            return false;
+        }
+    if (keep && keep->failed()) {
+        fprintf(stderr, "Error reading the positions to keep\n");
+        return false;
+    }
+    return true;
+}
+
+// Merges sorted run files into out as mergeFiles() does. More than
+// MERGE_FAN_IN runs are first merged in groups into intermediate runs next
+// to the first of each group, pass after pass, so memory stays bounded
+// however many runs there are; every position is then read once per pass.
+template <class Bits>
+bool mergeRuns(const std::vector<std::string>& runs, PositionReader<Bits>* keep, PositionWriter<Bits>& out) {
+    std::vector<std::string> level = runs, made;
+    bool ok = true;
+    while (ok && level.size() > MERGE_FAN_IN) {
+        std::vector<std::string> merged;
+        for (std::size_t i = 0; ok && i < level.size(); i += MERGE_FAN_IN) {
+            merged.push_back(level[i] + ".merged");
+            PositionWriter<Bits> w;
+            ok = w.open(merged.back()) && mergeFiles(&level[i], std::min(MERGE_FAN_IN, level.size() - i), static_cast<PositionReader<Bits>*>(nullptr), w) &&
+                 w.commit(false);
+            if (ok) made.push_back(merged.back());
+        }
+        level.swap(merged);
+    }
+    ok = ok && mergeFiles(level.data(), level.size(), keep, out);
+    for (std::size_t i = 0; i < made.size(); i++) unlink(made[i].c_str());
+    return ok;
+}
+
+#endif
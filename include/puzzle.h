@@ -0,0 +1,112 @@
+#ifndef PUZZLE_H
+#define PUZZLE_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "board_layout.h"
+#include "peg_engine.h"
+
+// A mid-game position with exactly one solution, as written by
+// tools/puzzle_gen. Puzzle files hold one per line:
+//
+//   BOARD RULES TARGET_ROW,TARGET_COL JUMPS ROW/ROW/...
+//
+// where each row has 'o' for a peg, '.' for an empty hole and '-' for no
+// hole, and lines starting with '#' are comments.
+struct Puzzle {
+    std::string board;      // layout name
+    int rules;              // JumpRules
+    int targetRow, targetCol;
+    int jumps;              // length of the solution
+    std::string picture;
+};
+
+template <class Engine>
+std::string puzzlePicture(const Engine& e, typename Engine::Bits pegs) {
+    std::string out;
+    for (int r = 0; r < e.rows(); r++) {
+        if (r) out += '/';
+        for (int c = 0; c < e.cols(); c++) {
+            int i = e.cellIndex(r, c);
+            out += i < 0 ? '-' : (pegs & Engine::bit(i)) ? 'o' : '.';
+        }
+    }
+    return out;
+}
+
+// False if the picture doesn't match the engine's board.
+template <class Engine>
+bool puzzlePegs(const Engine& e, const std::string& picture, typename Engine::Bits& pegs) {
+    pegs = 0;
+    int r = 0, c = 0;
+    for (std::size_t k = 0; k <= picture.size(); k++) {
+        if (k == picture.size() || picture[k] == '/') {
+            if (c != e.cols()) return false;
+            r++;
+            c = 0;
+            continue;
+        }
+        int i = e.cellIndex(r, c++);
+        if ((i < 0) != (picture[k] == '-')) return false;
+        if (picture[k] == 'o') pegs |= Engine::bit(i);
+        else if (picture[k] != '.' && picture[k] != '-') return false;
+    }
+    return r == e.rows();
+}
+
+inline std::string formatPuzzle(const Puzzle& p) {
+    char head[128];
+    snprintf(head, sizeof(head), "%s %s %d,%d %d ", p.board.c_str(), p.rules == RULES_DIAGONAL ? "diagonal" : "orthogonal", p.targetRow, p.targetCol, p.jumps);
+    return head + p.picture;
+}
+
+inline bool parsePuzzle(const std::string& line, Puzzle& p) {
+    char board[256], rules[32], picture[2048];
+    if (line.size() >= sizeof(picture) ||
+        sscanf(line.c_str(), "%255s %31s %d,%d %d %2047s", board, rules, &p.targetRow, &p.targetCol, &p.jumps, picture) != 6)
+        return false;
+    std::string r = rules;
+    if (r != "orthogonal" && r != "diagonal") return false;
+    p.board = board;
+    p.rules = r == "diagonal" ? RULES_DIAGONAL : RULES_ORTHOGONAL;
+    p.picture = picture;
+    return true;
+}
+
+inline bool loadPuzzleFile(const char* path, std::vector<Puzzle>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Error opening puzzle file: '%s'\n", path);
+        return false;
+    }
+    out.clear();
+    char buf[4096];
+    int lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(buf, sizeof(buf), f)) {
+        lineNo++;
+        std::string line = buf;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        Puzzle p;
+        ok = parsePuzzle(line, p);
+        if (ok) out.push_back(p);
+        else fprintf(stderr, "%s:%d: invalid puzzle\n", path, lineNo);
+    }
+    fclose(f);
+    return ok;
+}
+
+// The layout a puzzle is played on: current if it has the puzzle's board
+// name (so puzzles for a --board-file layout work), else the standard one.
+inline bool puzzleLayout(const Puzzle& p, const BoardLayout& current, BoardLayout& out) {
+    if (p.board == current.name) out = current;
+    else if (findLayout(p.board)) out = *findLayout(p.board);
+    else return false;
+    out = withRules(out, p.rules);
+    return out.grid == GRID_SQUARE || p.rules == RULES_ORTHOGONAL;
+}
+
+#endif
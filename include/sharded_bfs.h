@@ -0,0 +1,375 @@
+#ifndef SHARDED_BFS_H
+#define SHARDED_BFS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "checkpoint.h"
+#include "external_bfs.h"
+#include "peg_engine.h"
+#include "position_file.h"
+
+// Per worker counters, in shared memory so the coordinator can report them.
+struct ShardStats {
+    std::atomic<uint64_t> expanded;     // positions whose neighbours were generated
+    std::atomic<uint64_t> sent;         // neighbours handed to another shard
+    std::atomic<uint64_t> stalls;       // pushes that found the queue full
+    std::atomic<uint64_t> peak;         // most positions held at once
+    char pad[32];
+};
+
+// The same enumeration as BasicExternalBfs, split over worker processes
+// forked by a coordinator. A position belongs to the shard its hash picks;
+// each worker holds its shard of the layer being read and the one being
+// built, and sends every neighbour that belongs elsewhere through a
+// single-producer, single-consumer ring in shared memory, one ring per
+// ordered pair of workers. Layers advance together: a worker that has
+// expanded its shard keeps draining its incoming rings until every worker
+// has finished producing, then all meet at a barrier.
+//
+// Workers write their shard of each layer to a file of their own; when they
+// have all exited cleanly the coordinator merges the shards into the
+// reach-NNN.bin and win-NNN.bin layers of external_bfs.h, so the result is
+// the same database the game loads. If any worker dies the rest are killed
+// and run() fails. Sharded runs hold their layers in memory and don't
+// checkpoint; BasicExternalBfs is the one for tables larger than RAM.
+template <class Engine>
+class BasicShardedBfs {
+public:
+    typedef typename Engine::Bits Bits;
+
+    // Called about every 100 ms with the peg count of the layer being built
+    // and the positions expanded so far by all workers.
+    typedef std::function<void(int, uint64_t)> Progress;
+    static const int MAX_WORKERS = 64;
+    static const std::size_t QUEUE_SLOTS = 1 << 14;
+
+    BasicShardedBfs(const Engine& e, const std::string& directory, int workerCount)
+        : engine(e), dir(directory), workers(std::max(1, std::min(workerCount, static_cast<int>(MAX_WORKERS)))), target(-1), shared(nullptr),
+          sharedBytes(0), control(nullptr), queues(nullptr), slots(nullptr) {}
+    ~BasicShardedBfs() { unmapShared(); }
+
+    bool run(const std::string& board, Bits pegs, int targetCell, const Progress& progress = Progress()) {
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Error creating directory: '%s'\n", dir.c_str());
+            return false;
+        }
+        start = pegs;
+        target = targetCell;
+        stabilizer.clear();
+        for (int s = 1; s < engine.numSymmetries(); s++)
+            if (engine.symmetryCell(s, target) == target) stabilizer.push_back(s);
+        if (!mapShared()) return false;
+        std::vector<pid_t> pids;
+        for (int w = 0; w < workers; w++) {
+            pid_t pid = fork();
+            if (pid == 0) _exit(work(w) ? 0 : 1);
+            if (pid < 0) {
+                fprintf(stderr, "Error starting worker %d\n", w);
+                control->failed.store(1);
+                break;
+            }
+            pids.push_back(pid);
+        }
+        bool ok = wait(pids, progress) && merge(board);
+        removeShards();
+        stats.clear();
+        for (int w = 0; w < workers; w++) stats.push_back(control->stats[w]);
+        unmapShared();
+        return ok;
+    }
+
+    int workerCount() const { return workers; }
+    struct WorkerStats {
+        uint64_t expanded, sent, stalls, peak;
+        WorkerStats(const ShardStats& s) : expanded(s.expanded.load()), sent(s.sent.load()), stalls(s.stalls.load()), peak(s.peak.load()) {}
+    };
+    const std::vector<WorkerStats>& workerStats() const { return stats; }
+
+private:
+    struct alignas(64) Queue {
+        std::atomic<uint64_t> head;     // consumer's
+        char pad[56];
+        std::atomic<uint64_t> tail;     // producer's
+        char pad2[56];
+    };
+
+    struct alignas(64) Control {
+        std::atomic<uint64_t> producersDone;    // workers * phases finished producing
+        std::atomic<int> arrived, generation;   // barrier
+        std::atomic<int> failed;
+        std::atomic<int> layer;
+        ShardStats stats[MAX_WORKERS];
+    };
+
+    static const std::size_t COMPACT = 1 << 22;  // unsorted positions before a sort pass
+
+    // Anonymous shared memory mapped before the fork: the control block,
+    // then workers^2 ring headers, then their slots.
+    bool mapShared() {
+        std::size_t n = static_cast<std::size_t>(workers) * workers;
+        sharedBytes = sizeof(Control) + n * sizeof(Queue) + n * QUEUE_SLOTS * sizeof(Bits);
+        void* p = mmap(nullptr, sharedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "Error mapping %zu bytes of shared memory\n", sharedBytes);
+            return false;
+        }
+        shared = p;
+        control = new (p) Control();
+        queues = reinterpret_cast<Queue*>(static_cast<char*>(p) + sizeof(Control));
+        for (std::size_t i = 0; i < n; i++) new (&queues[i]) Queue();
+        slots = reinterpret_cast<Bits*>(queues + n);
+        return true;
+    }
+
+    void unmapShared() {
+        if (shared) munmap(shared, sharedBytes);
+        shared = nullptr;
+        control = nullptr;
+    }
+
+    Bits canonical(Bits pegs) const {
+        Bits best = pegs;
+        for (std::size_t i = 0; i < stabilizer.size(); i++) {
+            Bits p = engine.transform(pegs, stabilizer[i]);
+            if (p < best) best = p;
+        }
+        return best;
+    }
+
+    int owner(Bits key) const { return static_cast<int>(((uint64_t(std::hash<Bits>()(key)) * 0x9E3779B97F4A7C15ULL) >> 32) % workers); }
+
+    Queue& queue(int from, int to) const { return queues[from * workers + to]; }
+    Bits* ring(int from, int to) const { return slots + (static_cast<std::size_t>(from) * workers + to) * QUEUE_SLOTS; }
+
+    bool push(int from, int to, const Bits& b) {
+        Queue& q = queue(from, to);
+        uint64_t t = q.tail.load(std::memory_order_relaxed);
+        if (t - q.head.load(std::memory_order_acquire) == QUEUE_SLOTS) return false;
+        ring(from, to)[t % QUEUE_SLOTS] = b;
+        q.tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Moves whatever the other workers have sent into out.
+    void drain(int self, std::vector<Bits>& out) {
+        for (int from = 0; from < workers; from++) {
+            if (from == self) continue;
+            Queue& q = queue(from, self);
+            uint64_t h = q.head.load(std::memory_order_relaxed), t = q.tail.load(std::memory_order_acquire);
+            const Bits* r = ring(from, self);
+            for (; h != t; h++) out.push_back(r[h % QUEUE_SLOTS]);
+            q.head.store(h, std::memory_order_release);
+        }
+    }
+
+    static std::size_t compact(std::vector<Bits>& out, std::size_t sorted) {
+        std::sort(out.begin() + sorted, out.end());
+        std::inplace_merge(out.begin(), out.begin() + sorted, out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out.size();
+    }
+
+    void barrier() {
+        int gen = control->generation.load(std::memory_order_acquire);
+        if (control->arrived.fetch_add(1) + 1 == workers) {
+            control->arrived.store(0);
+            control->generation.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        while (control->generation.load(std::memory_order_acquire) == gen) sched_yield();
+    }
+
+    // One step of every worker at once: out becomes this shard of the
+    // canonical neighbours (parents, going backward) of every shard of from.
+    void exchange(int self, uint64_t phase, const std::vector<Bits>& from, bool backward, std::vector<Bits>& out) {
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        ShardStats& st = control->stats[self];
+        std::size_t sorted = 0;
+        out.clear();
+        for (std::size_t i = 0; i < from.size(); i++) {
+            int n = engine.generateMoves(backward ? engine.fullBoard() ^ from[i] : from[i], moves);
+            for (int k = 0; k < n; k++) {
+                Bits c = canonical(from[i] ^ engine.jumps()[moves[k]].flip);
+                int to = owner(c);
+                if (to == self) {
+                    out.push_back(c);
+                    continue;
+                }
+                if (!push(self, to, c)) {
+                    st.stalls.fetch_add(1, std::memory_order_relaxed);
+                    do drain(self, out);
+                    while (!push(self, to, c));
+                }
+                st.sent.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (out.size() - sorted > COMPACT) sorted = compact(out, sorted);
+            st.expanded.fetch_add(1, std::memory_order_relaxed);
+        }
+        control->producersDone.fetch_add(1, std::memory_order_release);
+        while (control->producersDone.load(std::memory_order_acquire) < (phase + 1) * workers) {
+            drain(self, out);
+            sched_yield();
+        }
+        drain(self, out);
+        compact(out, sorted);
+        if (out.size() + from.size() > st.peak.load(std::memory_order_relaxed)) st.peak.store(out.size() + from.size(), std::memory_order_relaxed);
+        barrier();
+    }
+
+    std::string shardPath(const char* kind, int pegs, int w) const {
+        char name[48];
+        snprintf(name, sizeof(name), "/%s-%03d-s%02d.bin", kind, pegs, w);
+        return dir + name;
+    }
+
+    bool writeShard(const char* kind, int pegs, int w, const std::vector<Bits>& layer) const {
+        PositionWriter<Bits> out;
+        if (!out.open(shardPath(kind, pegs, w))) return false;
+        for (std::size_t i = 0; i < layer.size(); i++) out.put(layer[i]);
+        return out.commit(false);
+    }
+
+    bool readShard(const char* kind, int pegs, int w, std::vector<Bits>& layer) const {
+        PositionReader<Bits> in;
+        if (!in.open(shardPath(kind, pegs, w))) return false;
+        layer.resize(in.size());
+        for (std::size_t i = 0; i < layer.size(); i++)
+            if (!in.next(layer[i])) return false;
+        return true;
+    }
+
+    // A worker's whole job. Every worker goes through the same phases, so
+    // none may leave early; a failure is flagged for the coordinator, which
+    // kills the rest.
+    bool work(int self) {
+        int top = pegCount(start);
+        uint64_t phase = 0;
+        std::vector<Bits> current, next, kept;
+        Bits first = canonical(start), goal = canonical(Engine::bit(target));
+        if (owner(first) == self) current.push_back(first);
+        bool ok = true;
+        for (int n = top; n > 1; n--) {
+            if (self == 0) control->layer.store(n - 1, std::memory_order_relaxed);
+            ok = writeShard("reach", n, self, current) && ok;
+            exchange(self, phase++, current, false, next);
+            current.swap(next);
+        }
+        ok = writeShard("reach", 1, self, current) && ok;
+        current.clear();
+        for (int n = 1;; n++) {
+            if (n > 1) {
+                if (self == 0) control->layer.store(n, std::memory_order_relaxed);
+                exchange(self, phase++, current, true, next);
+                if (!readShard("reach", n, self, kept)) ok = false;
+                current.clear();
+                std::set_intersection(next.begin(), next.end(), kept.begin(), kept.end(), std::back_inserter(current));
+            }
+            else if (owner(goal) == self && readShard("reach", 1, self, kept) && std::binary_search(kept.begin(), kept.end(), goal)) {
+                current.push_back(goal);
+            }
+            ok = writeShard("win", n, self, current) && ok;
+            if (n == top) break;
+        }
+        if (!ok) control->failed.store(1);
+        return ok;
+    }
+
+    bool wait(std::vector<pid_t>& pids, const Progress& progress) {
+        std::size_t left = pids.size();
+        bool ok = static_cast<int>(pids.size()) == workers;
+        while (left > 0) {
+            int status = 0;
+            pid_t pid = waitpid(-1, &status, WNOHANG);
+            if (pid > 0) {
+                left--;
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+            }
+            else if (pid < 0 && errno != EINTR) break;
+            if (!ok || control->failed.load()) {
+                if (ok) fprintf(stderr, "A worker failed; stopping the others\n");
+                else fprintf(stderr, "A worker died; stopping the others\n");
+                ok = false;
+                for (std::size_t i = 0; i < pids.size(); i++) kill(pids[i], SIGKILL);
+                while (waitpid(-1, &status, 0) > 0 || errno == EINTR) {}
+                break;
+            }
+            if (pid <= 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (progress) {
+                    uint64_t expanded = 0;
+                    for (int w = 0; w < workers; w++) expanded += control->stats[w].expanded.load(std::memory_order_relaxed);
+                    progress(control->layer.load(std::memory_order_relaxed), expanded);
+                }
+            }
+        }
+        return ok;
+    }
+
+    // Shards partition each layer, so merging them is a plain k-way merge.
+    bool merge(const std::string& board) {
+        int top = pegCount(start);
+        bool ok = true;
+        for (int n = 1; n <= top && ok; n++)
+            for (int k = 0; k < 2 && ok; k++) {
+                const char* kind = k ? "win" : "reach";
+                std::vector<std::string> shards;
+                for (int w = 0; w < workers; w++) shards.push_back(shardPath(kind, n, w));
+                PositionWriter<Bits> out;
+                ok = out.open(bfsLayerPath(dir, kind, n)) && mergeRuns(shards, static_cast<PositionReader<Bits>*>(nullptr), out) && out.commit(true);
+            }
+        if (!ok) return false;
+        BfsState s;
+        s.board = board;
+        s.cells = engine.numCells();
+        s.target = target;
+        s.start.assign(engine.numCells(), '0');
+        for (int i = 0; i < engine.numCells(); i++)
+            if (start & Engine::bit(i)) s.start[i] = '1';
+        s.reach = 1;
+        s.win = top;
+        s.offset = s.runs = s.read = 0;
+        return saveBfsState(dir, s, CheckpointClock());
+    }
+
+    void removeShards() const {
+        for (int n = 1; n <= pegCount(start); n++)
+            for (int w = 0; w < workers; w++) {
+                unlink(shardPath("reach", n, w).c_str());
+                unlink(shardPath("win", n, w).c_str());
+            }
+    }
+
+    const Engine& engine;
+    std::string dir;
+    int workers;
+    Bits start;
+    int target;
+    std::vector<int> stabilizer;    // symmetries other than the identity that fix the target
+    void* shared;
+    std::size_t sharedBytes;
+    Control* control;
+    Queue* queues;
+    Bits* slots;
+    std::vector<WorkerStats> stats;
+};
+
+typedef BasicShardedBfs<PegEngine> ShardedBfs;
+
+#endif
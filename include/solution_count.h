@@ -0,0 +1,208 @@
+#ifndef SOLUTION_COUNT_H
+#define SOLUTION_COUNT_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analysis.h"
+#include "live_positions.h"
+#include "peg_engine.h"
+
+// Number of jump sequences; the larger boards' totals overflow 64 bits.
+typedef unsigned __int128 SolutionCount;
+
+// Writes n in decimal into buf, which 40 digits and the terminator fit, and
+// returns where the digits start; doesn't allocate.
+inline const char* formatCount(SolutionCount n, char (&buf)[48]) {
+    int i = sizeof(buf) - 1;
+    buf[i] = 0;
+    do {
+        buf[--i] = static_cast<char>('0' + static_cast<int>(n % 10));
+        n /= 10;
+    } while (n);
+    return buf + i;
+}
+
+inline std::string formatCount(SolutionCount n) {
+    char buf[48];
+    return formatCount(n, buf);
+}
+
+// Counts the distinct jump sequences that end with a single peg on the target
+// from every live position of a start (see live_positions.h) at once: bottom
+// up by peg count, a position's count is the sum of its children's. Counts
+// sit in a dense table by live rank, so solutions() answers in O(1); any
+// position that isn't live has none.
+template <class Engine>
+class BasicSolutionCounter {
+public:
+    typedef typename Engine::Bits Bits;
+    typedef typename BasicLivePositions<Engine>::Progress Progress;
+    static const uint64_t PROGRESS_INTERVAL = BasicLivePositions<Engine>::PROGRESS_INTERVAL;
+    static const std::size_t LIVE_BYTES = std::size_t(512) << 20;
+
+    explicit BasicSolutionCounter(const Engine& e, std::size_t liveBytes = LIVE_BYTES) : engine(e), live(e), maxLive(liveBytes / sizeof(Bits)), ready(false) {}
+
+    // False if cancelled or if the live positions don't fit in liveBytes.
+    bool count(Bits start, int target, const Progress& progress = Progress()) {
+        ready = false;
+        counts.clear();
+        if (!live.find(start, target, maxLive, progress)) return false;
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        uint64_t n = live.expandedCount();
+        counts.assign(live.size(), 0);
+        for (std::size_t r = live.layerBegin(1); r < live.layerBegin(2); r++) counts[r] = 1;
+        for (std::size_t r = live.layerBegin(2); r < live.size(); r++) {
+            Bits pegs = live.position(r);
+            SolutionCount total = 0;
+            int m = engine.generateMoves(pegs, moves);
+            for (int k = 0; k < m; k++) total += solutions(engine.apply(pegs, moves[k]));
+            counts[r] = total;
+            if ((++n % PROGRESS_INTERVAL) == 0 && progress && !progress(n)) return false;
+        }
+        ready = true;
+        return true;
+    }
+
+    bool done() const { return ready; }
+    int targetCell() const { return live.targetCell(); }
+    Bits startPosition() const { return live.startPosition(); }
+    std::size_t positions() const { return live.size(); }
+    std::size_t bytes() const { return live.bytes() + counts.size() * sizeof(SolutionCount); }
+
+    // Solutions from a position reached from the counted start.
+    SolutionCount solutions(Bits pegs) const {
+        std::size_t r = live.rank(live.canonical(pegs));
+        return r == BasicLivePositions<Engine>::NONE ? 0 : counts[r];
+    }
+
+private:
+    const Engine& engine;
+    BasicLivePositions<Engine> live;
+    std::size_t maxLive;
+    bool ready;
+    std::vector<SolutionCount> counts;  // by live rank
+};
+
+typedef BasicSolutionCounter<PegEngine> SolutionCounter;
+
+enum CountStatus {
+    COUNT_RUNNING = 0,
+    COUNT_READY,
+    COUNT_TOO_LARGE     // the live positions didn't fit
+};
+
+// Keeps a counter's table for the latest requested start and target, built
+// on a worker thread; a request for another start or target cancels the
+// running count. Progress is published through a seqlock. Once the status
+// is COUNT_READY the table stays untouched until the next request, so the
+// render loop reads it without locking.
+template <class Engine>
+class BasicSolutionCountService {
+public:
+    typedef typename Engine::Bits Bits;
+
+    struct Result {
+        uint64_t generation;
+        uint64_t expanded;      // positions expanded so far
+        int32_t status;         // CountStatus
+        int32_t pad;
+    };
+
+    BasicSolutionCountService() : engine(nullptr), latest(0), startPegs(0), target(-1), stopping(false) {}
+    ~BasicSolutionCountService() { stop(); }
+
+    void start(const Engine* e) {
+        stop();
+        engine = e;
+        counter.reset(new BasicSolutionCounter<Engine>(*e));
+        stopping = false;
+        target = -1;
+        worker = std::thread(&BasicSolutionCountService::workerLoop, this);
+    }
+
+    // Also cancels a running count.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            latest.store(latest.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Counting again only when the start or target changed.
+    void request(Bits start, int targetCell) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (start == startPegs && targetCell == target) return;
+            startPegs = start;
+            target = targetCell;
+            latest.store(latest.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        wake.notify_all();
+    }
+
+    // Callers should ignore results whose generation isn't generation().
+    Result snapshot() const { return published.load(); }
+    uint64_t generation() const { return latest.load(std::memory_order_relaxed); }
+
+    // Only valid while the current generation's status is COUNT_READY.
+    SolutionCount solutions(Bits pegs) const { return counter->solutions(pegs); }
+
+private:
+    void workerLoop() {
+        uint64_t done = 0;
+        for (;;) {
+            Bits start;
+            int cell;
+            uint64_t gen;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || latest.load(std::memory_order_relaxed) != done; });
+                if (stopping) return;
+                start = startPegs;
+                cell = target;
+                gen = latest.load(std::memory_order_relaxed);
+            }
+            done = gen;
+            if (cell < 0) continue;
+            publish(gen, 0, COUNT_RUNNING);
+            bool ok = counter->count(start, cell, [&](uint64_t n) {
+                if (latest.load(std::memory_order_relaxed) != gen) return false;
+                publish(gen, n, COUNT_RUNNING);
+                return true;
+            });
+            if (latest.load(std::memory_order_relaxed) != gen) continue;
+            publish(gen, 0, ok ? COUNT_READY : COUNT_TOO_LARGE);
+        }
+    }
+
+    void publish(uint64_t gen, uint64_t expanded, CountStatus status) {
+        Result r;
+        r.generation = gen;
+        r.expanded = expanded;
+        r.status = status;
+        r.pad = 0;
+        published.store(r);
+    }
+
+    const Engine* engine;
+    std::unique_ptr<BasicSolutionCounter<Engine>> counter;
+    std::atomic<uint64_t> latest;
+    Bits startPegs;
+    int target;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    SeqlockSnapshot<Result> published;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded queue from exactly one producer thread to one consumer thread,
+// without locks: each side owns one index and only reads the other's. The
+// indices run freely and are masked into the ring, so N must be a power of
+// two. Each side keeps a copy of the other's index and rereads it only when
+// the ring looks full or empty, so a push or pop usually touches no cache
+// line the other thread writes.
+template <class T, std::size_t N>
+class SpscQueue {
+public:
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+    SpscQueue() : head(0), tailSeen(0), tail(0), headSeen(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only; false if the queue is full.
+    bool push(const T& value) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headSeen == N) {
+            headSeen = head.load(std::memory_order_acquire);
+            if (t - headSeen == N) return false;
+        }
+        slots[t & (N - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only; false if the queue is empty.
+    bool pop(T& value) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailSeen) {
+            tailSeen = tail.load(std::memory_order_acquire);
+            if (h == tailSeen) return false;
+        }
+        value = slots[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // From either side; out of date as soon as the other side moves.
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+private:
+    alignas(64) std::atomic<std::size_t> head;  // next slot to pop, written by the consumer
+    std::size_t tailSeen;                       // the consumer's copy of tail
+    alignas(64) std::atomic<std::size_t> tail;  // next slot to fill, written by the producer
+    std::size_t headSeen;                       // the producer's copy of head
+    alignas(64) T slots[N];
+};
+
+#endif
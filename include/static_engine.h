@@ -0,0 +1,221 @@
+#ifndef STATIC_ENGINE_H
+#define STATIC_ENGINE_H
+
+#include <stdint.h>
+#include <utility>
+
+#include "peg_engine.h"
+
+// The standard boards as compile-time data, in the text format of
+// parseLayout() (board_layout.h) on the grid given by GRID.
+struct EnglishLayout {
+    static constexpr int ROWS = 7, COLS = 7, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"..ooo..", "..ooo..", "ooooooo", "ooo*ooo", "ooooooo", "..ooo..", "..ooo.."};
+};
+
+// No single-hole game here can finish in its own starting hole.
+struct EuropeanLayout {
+    static constexpr int ROWS = 7, COLS = 7, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"..ooo..", ".oo*oo.", "ooooooo", "ooooooo", "ooooooo", ".oo@oo.", "..ooo.."};
+};
+
+struct WieglebLayout {
+    static constexpr int ROWS = 9, COLS = 9, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"...ooo...", "...ooo...", "...ooo...", "ooooooooo", "oooo*oooo",
+                                               "ooooooooo", "...ooo...", "...ooo...", "...ooo..."};
+};
+
+// The centre start can't leave a single peg anywhere on the diamond.
+struct DiamondLayout {
+    static constexpr int ROWS = 9, COLS = 9, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"....o....", "...ooo...", "..ooooo..", ".ooo*ooo.", "ooooooooo",
+                                               ".ooo@ooo.", "..ooooo..", "...ooo...", "....o...."};
+};
+
+struct AsymmetricLayout {
+    static constexpr int ROWS = 8, COLS = 8, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"..ooo...", "..ooo...", "..ooo...", "oooooooo", "ooo*oooo",
+                                               "oooooooo", "..ooo...", "..ooo..."};
+};
+
+// Hex grid boards: row r of a triangle holds columns 0..r, which
+// gridSteps() draws as an equilateral triangle.
+struct Triangle15Layout {
+    static constexpr int ROWS = 5, COLS = 5, GRID = GRID_HEX;
+    static constexpr const char* TEXT[ROWS] = {"*", "oo", "ooo", "oooo", "ooooo"};
+};
+
+struct Triangle21Layout {
+    static constexpr int ROWS = 6, COLS = 6, GRID = GRID_HEX;
+    static constexpr const char* TEXT[ROWS] = {"o", "oo", "o*o", "oooo", "ooooo", "oooooo"};
+};
+
+// As on the diamond, the centre start can't be won.
+struct Hexagon37Layout {
+    static constexpr int ROWS = 7, COLS = 7, GRID = GRID_HEX;
+    static constexpr const char* TEXT[ROWS] = {"oooo...", "ooooo..", "oo*ooo.", "ooooooo", ".ooo@oo", "..ooooo", "...oooo"};
+};
+
+// Boards over 64 cells: data only, they run on WidePegEngine without
+// compiled kernels.
+struct Cross9Layout {
+    static constexpr int ROWS = 9, COLS = 9, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"..ooooo..", "..ooooo..", "ooooooooo", "ooooooooo", "oooo*oooo",
+                                               "ooooooooo", "ooooooooo", "..ooooo..", "..ooooo.."};
+};
+
+struct Cross11Layout {
+    static constexpr int ROWS = 11, COLS = 11, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"...ooooo...", "...ooooo...", "...ooooo...", "ooooooooooo", "ooooooooooo", "ooooo*ooooo",
+                                               "ooooooooooo", "ooooooooooo", "...ooooo...", "...ooooo...", "...ooooo..."};
+};
+
+struct RectangleLayout {
+    static constexpr int ROWS = 10, COLS = 12, GRID = GRID_SQUARE;
+    static constexpr const char* TEXT[ROWS] = {"oooooooooooo", "oooooooooooo", "oooooooooooo", "oooooooooooo", "ooooo*oooooo",
+                                               "oooooooooooo", "oooooooooooo", "oooooooooooo", "oooooooooooo", "oooooooooooo"};
+};
+
+// Cell index, jump table and symmetry permutations of a layout under a rule
+// set, built the same way (and in the same order) as PegEngine's, so jump
+// indices are interchangeable between the two.
+template<class L>
+struct StaticTables {
+    static const int MAX_JUMPS = GridSteps::MAX_DIRECTIONS * PegEngine::MAX_CELLS;
+
+    int nCells = 0, nJumps = 0, nSyms = 0;
+    int index[L::ROWS * L::COLS] = {};
+    int cellRow[PegEngine::MAX_CELLS] = {}, cellCol[PegEngine::MAX_CELLS] = {};
+    int from[MAX_JUMPS] = {}, over[MAX_JUMPS] = {}, to[MAX_JUMPS] = {};
+    PegBits toBit[MAX_JUMPS] = {}, flip[MAX_JUMPS] = {};
+    int sym[12][PegEngine::MAX_CELLS] = {};
+
+    constexpr int cellIndex(int r, int c) const {
+        return r < 0 || r >= L::ROWS || c < 0 || c >= L::COLS ? -1 : index[r * L::COLS + c];
+    }
+};
+
+template<class L>
+constexpr bool layoutHole(int r, int c) {
+    const char* row = L::TEXT[r];
+    for (int i = 0; i < c; i++)
+        if (!row[i]) return false;
+    return row[c] == 'o' || row[c] == '*' || row[c] == '@';
+}
+
+template<class L, int RULES>
+constexpr StaticTables<L> buildTables() {
+    StaticTables<L> t;
+    for (int r = 0; r < L::ROWS; r++)
+        for (int c = 0; c < L::COLS; c++) {
+            t.index[r * L::COLS + c] = -1;
+            if (!layoutHole<L>(r, c) || t.nCells == PegEngine::MAX_CELLS) continue;
+            t.index[r * L::COLS + c] = t.nCells;
+            t.cellRow[t.nCells] = r;
+            t.cellCol[t.nCells] = c;
+            t.nCells++;
+        }
+    const GridSteps steps = gridSteps(L::GRID, RULES);
+    for (int i = 0; i < t.nCells; i++)
+        for (int k = 0; k < steps.count; k++) {
+            int over = t.cellIndex(t.cellRow[i] + steps.dRow[k], t.cellCol[i] + steps.dCol[k]);
+            int to = t.cellIndex(t.cellRow[i] + 2 * steps.dRow[k], t.cellCol[i] + 2 * steps.dCol[k]);
+            if (over < 0 || to < 0) continue;
+            t.from[t.nJumps] = i;
+            t.over[t.nJumps] = over;
+            t.to[t.nJumps] = to;
+            t.toBit[t.nJumps] = PegBits(1) << to;
+            t.flip[t.nJumps] = (PegBits(1) << i) | (PegBits(1) << over) | (PegBits(1) << to);
+            t.nJumps++;
+        }
+    for (int s = 0; s < gridSymmetries(L::GRID); s++) {
+        int imageRow[PegEngine::MAX_CELLS] = {}, imageCol[PegEngine::MAX_CELLS] = {};
+        int minRow = 0, minCol = 0;
+        for (int i = 0; i < t.nCells; i++) {
+            gridSymmetry(L::GRID, s, t.cellRow[i], t.cellCol[i], imageRow[i], imageCol[i]);
+            if (i == 0 || imageRow[i] < minRow || (imageRow[i] == minRow && imageCol[i] < minCol)) {
+                minRow = imageRow[i];
+                minCol = imageCol[i];
+            }
+        }
+        bool ok = true;
+        for (int i = 0; i < t.nCells && ok; i++) {
+            t.sym[t.nSyms][i] = t.cellIndex(imageRow[i] - minRow + t.cellRow[0], imageCol[i] - minCol + t.cellCol[0]);
+            ok = t.sym[t.nSyms][i] >= 0;
+        }
+        if (ok) t.nSyms++;
+    }
+    return t;
+}
+
+// Move generation for one fixed layout and rule set: every jump's masks are
+// compile-time constants and the loop over the jump table is unrolled, so
+// all directions are tested in one straight run.
+template<class L, int RULES = RULES_ORTHOGONAL>
+class StaticEngine {
+public:
+    static constexpr StaticTables<L> TABLES = buildTables<L, RULES>();
+    static constexpr int NUM_CELLS = TABLES.nCells;
+    static constexpr int NUM_JUMPS = TABLES.nJumps;
+    static constexpr int NUM_SYMMETRIES = TABLES.nSyms;
+
+    static int generateMoves(PegBits pegs, int* out) {
+        return generate(pegs, out, std::make_index_sequence<NUM_JUMPS>());
+    }
+
+    static bool hasMoves(PegBits pegs) {
+        return any(pegs, std::make_index_sequence<NUM_JUMPS>());
+    }
+
+    static PegBits transform(PegBits pegs, int s) {
+        PegBits out = 0;
+        for (; pegs; pegs &= pegs - 1) out |= pegBit(TABLES.sym[s][pegLowest(pegs)]);
+        return out;
+    }
+
+    // True if e was built from this layout, so its jump indices and ours
+    // mean the same thing.
+    static bool matches(const PegEngine& e) {
+        if (e.grid() != L::GRID || e.rules() != RULES || e.rows() != L::ROWS || e.cols() != L::COLS || e.numCells() != NUM_CELLS || e.numJumps() != NUM_JUMPS) return false;
+        for (int i = 0; i < NUM_CELLS; i++)
+            if (e.cellRow(i) != TABLES.cellRow[i] || e.cellCol(i) != TABLES.cellCol[i]) return false;
+        for (int k = 0; k < NUM_JUMPS; k++)
+            if (e.jumps()[k].flip != TABLES.flip[k] || e.jumps()[k].to != TABLES.to[k]) return false;
+        return true;
+    }
+
+private:
+    template<std::size_t... K>
+    static int generate(PegBits pegs, int* out, std::index_sequence<K...>) {
+        int n = 0;
+        ((out[n] = static_cast<int>(K), n += ((pegs ^ TABLES.toBit[K]) & TABLES.flip[K]) == TABLES.flip[K]), ...);
+        return n;
+    }
+
+    template<std::size_t... K>
+    static bool any(PegBits pegs, std::index_sequence<K...>) {
+        return ((((pegs ^ TABLES.toBit[K]) & TABLES.flip[K]) == TABLES.flip[K]) || ...);
+    }
+};
+
+template<class L, int RULES = RULES_ORTHOGONAL>
+inline bool tryStaticKernels(PegEngine& e) {
+    if (!StaticEngine<L, RULES>::matches(e)) return false;
+    e.useKernels(&StaticEngine<L, RULES>::generateMoves, &StaticEngine<L, RULES>::hasMoves);
+    return true;
+}
+
+// Runtime dispatch: installs the compiled kernels of whichever standard
+// layout e was built from. Engines for any other layout (loaded from a
+// file, say) keep the table-driven loops.
+inline bool useStaticKernels(PegEngine& e) {
+    if (e.rules() == RULES_DIAGONAL)
+        return tryStaticKernels<EnglishLayout, RULES_DIAGONAL>(e) || tryStaticKernels<EuropeanLayout, RULES_DIAGONAL>(e) ||
+               tryStaticKernels<WieglebLayout, RULES_DIAGONAL>(e) || tryStaticKernels<DiamondLayout, RULES_DIAGONAL>(e) ||
+               tryStaticKernels<AsymmetricLayout, RULES_DIAGONAL>(e);
+    return tryStaticKernels<EnglishLayout>(e) || tryStaticKernels<EuropeanLayout>(e) || tryStaticKernels<WieglebLayout>(e) ||
+           tryStaticKernels<DiamondLayout>(e) || tryStaticKernels<AsymmetricLayout>(e) || tryStaticKernels<Triangle15Layout>(e) ||
+           tryStaticKernels<Triangle21Layout>(e) || tryStaticKernels<Hexagon37Layout>(e);
+}
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <new>
+#include <thread>
+
+#include "wide_bits.h"
+
+// The 64-bit word a table entry is verified against: the position itself on
+// boards of up to 64 cells, a hash of it on wider ones (two wide positions
+// are then mistaken for each other with odds of about 2^-64 per probe).
+inline uint64_t tableKey(uint64_t b) { return b; }
+inline uint64_t tableKey(const WideBits& b) { return std::hash<WideBits>()(b); }
+
+// An entry as stored and as written to a checkpoint: check is the key XORed
+// with data, data packs the value, depth and age and is 0 in an empty slot.
+struct TableEntry {
+    uint64_t check;
+    uint64_t data;
+};
+
+// Table counters, summed over the threads using the table.
+struct TableStats {
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t stores;
+    uint64_t collisions;    // stores that evicted an entry for another position
+    uint64_t contended;     // probes that saw a slot change under them
+};
+
+// Fixed-size transposition table shared by any number of threads without
+// locks. The table is an array of 64-byte clusters of four entries, one cache
+// line each; a position may sit in any entry of the cluster its hash picks.
+//
+// Entries are two independent 64-bit words written without synchronisation,
+// so a reader racing a writer can see half of each. The check word holds the
+// key XORed with the data word, and a probe only trusts an entry whose two
+// words agree: a torn entry reads as a miss, never as another position's
+// value.
+//
+// A store goes to the entry already holding its position, else an empty
+// one, else the entry that is least worth keeping: shallowest, with every
+// search it has outlived (see newSearch()) counting as AGE_WEIGHT of depth.
+//
+// The memory is mapped directly and, where the kernel supports it, asked to
+// be backed by 2 MiB pages so that random probes don't miss the TLB as well
+// as the cache.
+template <class Bits>
+class TranspositionTable {
+public:
+    static const int WAYS = 4;
+    static const int AGE_WEIGHT = 4;
+    static const std::size_t HUGE_PAGE = std::size_t(2) << 20;
+
+    // Rounds bytes down to a power-of-two number of clusters, at least two.
+    explicit TranspositionTable(std::size_t bytes) : clusters(nullptr), mapped(nullptr), mappedBytes(0), count(2), shift(63), age(0) {
+        while (count * 2 * sizeof(Cluster) <= bytes) {
+            count *= 2;
+            shift--;
+        }
+        allocate();
+        resetStats();
+    }
+    ~TranspositionTable() {
+        if (mapped) munmap(mapped, mappedBytes);
+    }
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // The value stored for key and the depth it was stored with; false if
+    // there is none.
+    bool probe(const Bits& key, int& value, int& depth) const {
+        uint64_t k = tableKey(key);
+        const Cluster& c = cluster(k);
+        Stripe& s = stripe();
+        bump(s.probes);
+        for (int i = 0; i < WAYS; i++) {
+            uint64_t check = c.entries[i].check.load(std::memory_order_relaxed);
+            uint64_t data = c.entries[i].data.load(std::memory_order_relaxed);
+            if (data && (check ^ data) == k) {
+                bump(s.hits);
+                value = static_cast<int>(data & 0xff);
+                depth = static_cast<int>((data >> 8) & 0xff);
+                return true;
+            }
+            if (data && c.entries[i].check.load(std::memory_order_relaxed) != check) bump(s.contended);
+        }
+        return false;
+    }
+
+    // value and depth are 0..255.
+    void store(const Bits& key, int value, int depth) {
+        uint64_t k = tableKey(key);
+        Cluster& c = cluster(k);
+        Stripe& s = stripe();
+        bump(s.stores);
+        int victim = -1, worst = 0x7fffffff;
+        for (int i = 0; i < WAYS; i++) {
+            uint64_t data = c.entries[i].data.load(std::memory_order_relaxed);
+            if (!data || (c.entries[i].check.load(std::memory_order_relaxed) ^ data) == k) {
+                victim = i + WAYS;
+                break;
+            }
+            int keep = static_cast<int>((data >> 8) & 0xff) - AGE_WEIGHT * static_cast<uint8_t>(age - ((data >> 16) & 0xff));
+            if (keep < worst) {
+                victim = i;
+                worst = keep;
+            }
+        }
+        if (victim < WAYS) bump(s.collisions);
+        victim %= WAYS;
+        uint64_t data = USED | uint64_t(age) << 16 | uint64_t(depth & 0xff) << 8 | uint64_t(value & 0xff);
+        c.entries[victim].data.store(data, std::memory_order_relaxed);
+        c.entries[victim].check.store(k ^ data, std::memory_order_relaxed);
+    }
+
+    // Ages every entry by one search, making room for the next one.
+    void newSearch() { age++; }
+
+    void clear() {
+        for (std::size_t i = 0; i < count; i++)
+            for (int w = 0; w < WAYS; w++) {
+                clusters[i].entries[w].check.store(0, std::memory_order_relaxed);
+                clusters[i].entries[w].data.store(0, std::memory_order_relaxed);
+            }
+        age = 0;
+    }
+
+    std::size_t entries() const { return count * WAYS; }
+    std::size_t bytes() const { return count * sizeof(Cluster); }
+    bool hugePages() const { return advised; }
+    uint8_t currentAge() const { return age; }
+    void setAge(uint8_t a) { age = a; }
+
+    // Raw entries, for saving and restoring the table while no other thread
+    // is using it.
+    TableEntry entry(std::size_t i) const {
+        const Slot& e = clusters[i / WAYS].entries[i % WAYS];
+        TableEntry t = {e.check.load(std::memory_order_relaxed), e.data.load(std::memory_order_relaxed)};
+        return t;
+    }
+    void setEntry(std::size_t i, const TableEntry& t) {
+        Slot& e = clusters[i / WAYS].entries[i % WAYS];
+        e.check.store(t.check, std::memory_order_relaxed);
+        e.data.store(t.data, std::memory_order_relaxed);
+    }
+
+    // Fraction of entries in use; scans the whole table.
+    double occupancy() const {
+        std::size_t used = 0;
+        for (std::size_t i = 0; i < count; i++)
+            for (int w = 0; w < WAYS; w++) used += clusters[i].entries[w].data.load(std::memory_order_relaxed) != 0;
+        return static_cast<double>(used) / entries();
+    }
+
+    TableStats stats() const {
+        TableStats t = {0, 0, 0, 0, 0};
+        for (int i = 0; i < STRIPES; i++) {
+            t.probes += stripes[i].probes.load(std::memory_order_relaxed);
+            t.hits += stripes[i].hits.load(std::memory_order_relaxed);
+            t.stores += stripes[i].stores.load(std::memory_order_relaxed);
+            t.collisions += stripes[i].collisions.load(std::memory_order_relaxed);
+            t.contended += stripes[i].contended.load(std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    void resetStats() {
+        for (int i = 0; i < STRIPES; i++) {
+            stripes[i].probes.store(0, std::memory_order_relaxed);
+            stripes[i].hits.store(0, std::memory_order_relaxed);
+            stripes[i].stores.store(0, std::memory_order_relaxed);
+            stripes[i].collisions.store(0, std::memory_order_relaxed);
+            stripes[i].contended.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static const uint64_t USED = uint64_t(1) << 24;
+    static const int STRIPES = 64;
+
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    struct alignas(64) Cluster {
+        Slot entries[WAYS];
+    };
+
+    // Each thread counts in a cache line of its own, so counting doesn't
+    // make the threads contend where the table itself doesn't, and with a
+    // plain load and store rather than a locked add. Beyond STRIPES threads
+    // lines are shared and the odd count may be lost.
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> probes, hits, stores, collisions, contended;
+    };
+
+    static void bump(std::atomic<uint64_t>& n) { n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    Stripe& stripe() const {
+        static std::atomic<unsigned> threads(0);
+        static thread_local unsigned index = threads.fetch_add(1) % STRIPES;
+        return stripes[index];
+    }
+
+    Cluster& cluster(uint64_t k) const { return clusters[(k * 0x9E3779B97F4A7C15ULL) >> shift]; }
+
+    // Maps a huge page more than needed so the table can start on a huge
+    // page boundary. Fresh anonymous memory is already zero: every entry
+    // empty.
+    void allocate() {
+        std::size_t size = count * sizeof(Cluster);
+        mappedBytes = size >= HUGE_PAGE ? size + HUGE_PAGE : size;
+        mapped = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            fprintf(stderr, "Error mapping %zu bytes for the transposition table\n", mappedBytes);
+            abort();
+        }
+        char* base = static_cast<char*>(mapped);
+        if (size >= HUGE_PAGE) base += (HUGE_PAGE - reinterpret_cast<uintptr_t>(base) % HUGE_PAGE) % HUGE_PAGE;
+        advised = false;
+#ifdef MADV_HUGEPAGE
+        advised = size >= HUGE_PAGE && madvise(base, size, MADV_HUGEPAGE) == 0;
+#endif
+        clusters = new (base) Cluster[count];
+    }
+
+    Cluster* clusters;
+    void* mapped;
+    std::size_t mappedBytes;
+    std::size_t count;      // clusters, a power of two
+    int shift;              // 64 - log2(count)
+    uint8_t age;
+    bool advised;
+    mutable Stripe stripes[STRIPES];
+};
+
+#endif
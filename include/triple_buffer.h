@@ -0,0 +1,44 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands whole values from one writer thread to one reader thread without
+// locks. Of three buffers the writer fills one, the reader reads another
+// and the third holds the latest published value. Publishing swaps the
+// writer's buffer for that one; the reader swaps its own for it only when
+// something new was published. Neither side ever waits, and the value the
+// reader holds stays untouched until it takes the next one.
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), writing(0), reading(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer only. Holds an older value than the last one published, so
+    // every field must be filled in before publish().
+    T& back() { return buffers[writing]; }
+    void publish() { writing = middle.exchange(writing | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+    // Reader only: moves front() to the latest published value; false if
+    // there was none newer.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        reading = middle.exchange(reading, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return buffers[reading]; }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;     // set while the middle buffer is unread
+
+    T buffers[3];
+    alignas(64) std::atomic<int> middle;
+    alignas(64) int writing;
+    alignas(64) int reading;
+};
+
+#endif
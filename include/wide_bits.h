@@ -0,0 +1,99 @@
+#ifndef WIDE_BITS_H
+#define WIDE_BITS_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+
+// 256-bit position for boards with more than 64 cells. The bitwise operators
+// work on all four words at once through GCC's vector extension (two SSE2 or
+// one AVX2 instruction); shifts are only needed while building tables and go
+// word by word.
+typedef uint64_t WideWords __attribute__((vector_size(32)));
+
+struct WideBits {
+    static const int WORDS = 4;
+    WideWords v;
+
+    WideBits() : v(WideWords{0, 0, 0, 0}) {}
+    WideBits(uint64_t low) : v(WideWords{low, 0, 0, 0}) {}
+
+    uint64_t word(int i) const { return v[i]; }
+
+    explicit operator bool() const { return (v[0] | v[1] | v[2] | v[3]) != 0; }
+
+    WideBits operator^(const WideBits& o) const { return make(v ^ o.v); }
+    WideBits operator&(const WideBits& o) const { return make(v & o.v); }
+    WideBits operator|(const WideBits& o) const { return make(v | o.v); }
+    WideBits operator~() const { return make(~v); }
+    WideBits& operator^=(const WideBits& o) { v ^= o.v; return *this; }
+    WideBits& operator&=(const WideBits& o) { v &= o.v; return *this; }
+    WideBits& operator|=(const WideBits& o) { v |= o.v; return *this; }
+
+    bool operator==(const WideBits& o) const {
+        WideWords d = v ^ o.v;
+        return (d[0] | d[1] | d[2] | d[3]) == 0;
+    }
+    bool operator!=(const WideBits& o) const { return !(*this == o); }
+    bool operator<(const WideBits& o) const {
+        for (int i = WORDS - 1; i >= 0; i--)
+            if (v[i] != o.v[i]) return v[i] < o.v[i];
+        return false;
+    }
+
+    WideBits operator<<(int n) const {
+        WideBits out;
+        int w = n / 64, b = n % 64;
+        for (int i = WORDS - 1; i >= w; i--) {
+            uint64_t x = v[i - w] << b;
+            if (b && i - w - 1 >= 0) x |= v[i - w - 1] >> (64 - b);
+            out.v[i] = x;
+        }
+        return out;
+    }
+    WideBits operator>>(int n) const {
+        WideBits out;
+        int w = n / 64, b = n % 64;
+        for (int i = 0; i + w < WORDS; i++) {
+            uint64_t x = v[i + w] >> b;
+            if (b && i + w + 1 < WORDS) x |= v[i + w + 1] << (64 - b);
+            out.v[i] = x;
+        }
+        return out;
+    }
+
+private:
+    static WideBits make(const WideWords& w) {
+        WideBits b;
+        b.v = w;
+        return b;
+    }
+};
+
+inline int pegCount(const WideBits& b) {
+    return __builtin_popcountll(b.v[0]) + __builtin_popcountll(b.v[1]) + __builtin_popcountll(b.v[2]) + __builtin_popcountll(b.v[3]);
+}
+
+inline int pegLowest(const WideBits& b) {
+    for (int i = 0; i < WideBits::WORDS; i++)
+        if (b.v[i]) return 64 * i + __builtin_ctzll(b.v[i]);
+    return -1;
+}
+
+inline int lowByte(const WideBits& b) { return static_cast<int>(b.v[0] & 0xff); }
+inline uint64_t lowWord(const WideBits& b) { return b.v[0]; }
+
+namespace std {
+template <>
+struct hash<WideBits> {
+    std::size_t operator()(const WideBits& b) const {
+        uint64_t h = b.v[0] * 0x9E3779B97F4A7C15ULL;
+        h ^= (b.v[1] + (h << 6) + (h >> 2)) * 0xC2B2AE3D27D4EB4FULL;
+        h ^= (b.v[2] + (h << 6) + (h >> 2)) * 0x165667B19E3779F9ULL;
+        h ^= (b.v[3] + (h << 6) + (h >> 2)) * 0x27D4EB2F165667C5ULL;
+        return static_cast<std::size_t>(h ^ (h >> 29));
+    }
+};
+}
+
+#endif
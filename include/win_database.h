@@ -0,0 +1,122 @@
+#ifndef WIN_DATABASE_H
+#define WIN_DATABASE_H
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "external_bfs.h"
+#include "peg_engine.h"
+#include "peg_solver.h"
+
+// Read-only winnability lookups over a finished enumeration directory (see
+// external_bfs.h). Each layer file is mapped and binary searched, so a lookup
+// touches a few pages and the database can be far larger than memory.
+// Positions the enumeration never reached, from another start, are unknown.
+template <class Engine>
+class BasicWinDatabase {
+public:
+    typedef typename Engine::Bits Bits;
+
+    BasicWinDatabase() : engine(nullptr), target(-1) {}
+    ~BasicWinDatabase() { close(); }
+
+    // False if the directory holds no finished enumeration of this board.
+    bool open(const std::string& dir, const Engine& e, const std::string& board) {
+        close();
+        BfsState s;
+        if (!loadBfsState(dir, s) || !s.finished() || s.board != board || s.cells != e.numCells()) return false;
+        engine = &e;
+        target = s.target;
+        for (int n = 0; n <= s.top(); n++) {
+            Layer l = {{nullptr, nullptr}, {0, 0}};
+            if (n > 0 && (!mapFile(bfsLayerPath(dir, "reach", n), l.data[0], l.count[0]) || !mapFile(bfsLayerPath(dir, "win", n), l.data[1], l.count[1]))) {
+                layers.push_back(l);
+                close();
+                return false;
+            }
+            layers.push_back(l);
+        }
+        for (int i = 1; i < e.numSymmetries(); i++)
+            if (e.symmetryCell(i, target) == target) stabilizer.push_back(i);
+        return true;
+    }
+
+    void close() {
+        for (std::size_t n = 0; n < layers.size(); n++)
+            for (int k = 0; k < 2; k++)
+                if (layers[n].data[k]) munmap(const_cast<Bits*>(layers[n].data[k]), layers[n].count[k] * sizeof(Bits));
+        layers.clear();
+        stabilizer.clear();
+        engine = nullptr;
+        target = -1;
+    }
+
+    bool covers(int targetCell) const { return engine && targetCell == target; }
+
+    SolveStatus lookup(Bits pegs) const {
+        int n = pegCount(pegs);
+        if (!engine || n <= 0 || n >= static_cast<int>(layers.size())) return SOLVE_UNKNOWN;
+        Bits key = canonical(pegs);
+        if (contains(layers[n], 1, key)) return SOLVE_WINNABLE;
+        return contains(layers[n], 0, key) ? SOLVE_LOST : SOLVE_UNKNOWN;
+    }
+
+    // A jump that keeps a winnable position winnable, or -1.
+    int winningMove(Bits pegs) const {
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        int n = engine ? engine->generateMoves(pegs, moves) : 0;
+        for (int k = 0; k < n; k++)
+            if (lookup(engine->apply(pegs, moves[k])) == SOLVE_WINNABLE) return moves[k];
+        return -1;
+    }
+
+private:
+    struct Layer {
+        const Bits* data[2];        // reach, win
+        std::size_t count[2];
+    };
+
+    Bits canonical(Bits pegs) const {
+        Bits best = pegs;
+        for (std::size_t i = 0; i < stabilizer.size(); i++) {
+            Bits p = engine->transform(pegs, stabilizer[i]);
+            if (p < best) best = p;
+        }
+        return best;
+    }
+
+    static bool contains(const Layer& l, int k, Bits key) { return std::binary_search(l.data[k], l.data[k] + l.count[k], key); }
+
+    static bool mapFile(const std::string& path, const Bits*& data, std::size_t& count) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        fstat(fd, &st);
+        count = st.st_size / sizeof(Bits);
+        data = nullptr;
+        if (count > 0) {
+            void* addr = mmap(nullptr, count * sizeof(Bits), PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                data = static_cast<const Bits*>(addr);
+                madvise(addr, count * sizeof(Bits), MADV_RANDOM);
+            }
+        }
+        ::close(fd);
+        return count == 0 || data != nullptr;
+    }
+
+    const Engine* engine;
+    int target;
+    std::vector<int> stabilizer;    // symmetries other than the identity that fix target
+    std::vector<Layer> layers;      // by peg count
+};
+
+typedef BasicWinDatabase<PegEngine> WinDatabase;
+
+#endif
@@ -4,12 +4,18 @@
 #include <string>
 #include <cstdlib>
 #include <vector>
-#include <stack>
 #include <array>
 #include <cmath>
 #include <cstring>
+#include <cstdarg>
+#include <new>
 #include <stdexcept>
 #include <utility>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -19,53 +25,408 @@
 #include "backends/imgui_impl_opengl3.h"
 #include "file_utils.h"
 #include "math_utils.h"
+#include "peg_engine.h"
+#include "board_layout.h"
+#include "playout.h"
+#include "analysis.h"
+#include "event_log.h"
+#include "input_record.h"
+#include "game_record.h"
+#include "game_archive.h"
+#include "move_solver.h"
+#include "solution_count.h"
+#include "puzzle.h"
+#include "alloc_stats.h"
+#include "latency_stats.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+#include "move_history.h"
 #define GL_SILENCE_DEPRECATION
 
+// Every allocation goes through here so that --profile and --alloc-check can
+// count it (see alloc_stats.h).
+void* operator new(std::size_t n) {
+    AllocTracker::note(n);
+    void* p = std::malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void* operator new(std::size_t n, std::align_val_t align) {
+    AllocTracker::note(n);
+    std::size_t a = static_cast<std::size_t>(align);
+    void* p = std::aligned_alloc(a, (std::max<std::size_t>(n, 1) + a - 1) / a * a);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](std::size_t n, std::align_val_t align) { return operator new(n, align); }
+// GCC takes the frees for mismatches once inlined into a delete expression.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+static void* imguiAlloc(std::size_t n, void*) {
+    AllocTracker::note(ALLOC_IMGUI, n);
+    return std::malloc(n);
+}
+static void imguiFree(void* p, void*) { std::free(p); }
+
+// Engine is PegEngine, or WidePegEngine for boards of more than 64 cells.
+template <class Engine>
 class MarbleSolitaireGame {
 public:
-    static const int BOARD_SIZE = 7;
+    typedef typename Engine::Bits Bits;
+    typedef typename Engine::Jump Jump;
+    typedef BasicAnalysisService<Engine> Analysis;
+    typedef BasicDifficultyEstimator<Engine> Difficulty;
+    typedef BasicSolutionCountService<Engine> SolutionCounts;
+
     static constexpr float CELL_SIZE = 0.25f;
+    static constexpr float BOARD_EXTENT = 1.75f;    // boards over 7 cells across shrink to fit
     static const int WindowWidth = 800;
     static const int WindowHeight = 600;
     const char* pVSFileName = "shaders/shader.vs";
     const char* pFSFileName = "shaders/shader.fs";
 
-    MarbleSolitaireGame() : initialEmptyRow(3), initialEmptyCol(3), selRow(-1), selCol(-1), stepCounter(0), statusMessage(""), window(nullptr){
-        for (auto& row : board) row.fill(0);
+    MarbleSolitaireGame() : selRow(-1), selCol(-1), hintJump(-1), hintPending(false), puzzleIndex(-1), puzzleStart(0), recordPath("game.msr"), profiling(false), inputEvents(0), queuedSeq(0), presentedSeq(0), appliedSeq(0), simStopping(false), singleThreaded(false), lowLatency(false), clickOnPress(false), swapInterval(SWAP_DRIVER_DEFAULT), clickShown(), presentShown(), inputShown(), archiving(false), gameFinished(false), gameStartTime(0.0), stepCounter(0), window(nullptr){
+        statusMessage[0] = 0;
+        clock.useSource(glfwGetTime);
+        useLayout(*findLayout("english"));
     }
 
     void run() {
-        if (!initGLFW()) return;
-        glewExperimental = GL_TRUE;
-        glewInit();
+        AllocScope scope(ALLOC_FRAME);
+        if (!initWindow(true)) return;
         printf("GL version: %s\n", glGetString(GL_VERSION));
-        InitImGui(window);
-        onInit();
         glfwSetWindowUserPointer(window, this);
         glfwSetKeyCallback(window, key_callback);
         glfwSetMouseButtonCallback(window, mouse_button_callback);
+        if (swapInterval != SWAP_DRIVER_DEFAULT) glfwSwapInterval(swapInterval);
         while (!glfwWindowShouldClose(window)) {
-            glClear(GL_COLOR_BUFFER_BIT);
-            onDisplay();
-            RenderImGui();
-            glfwSwapBuffers(window);
+            if (lowLatency) {
+                glfwPollEvents();
+                awaitInput();
+                presentFrame();
+            }
+            else {
+                presentFrame();
+                glfwPollEvents();
+            }
+        }
+        closeWindow();
+        if (!history.played().empty() && !gameFinished) archiveGame(OUTCOME_ABANDONED);
+        archive.close();
+        recorder.close();
+    }
+
+    // Must be called before run(); path == nullptr logs to stdout.
+    bool setLogging(LogLevel level, const char* path) {
+        return eventLog.open(level, path);
+    }
+
+    // Must be called before run(); every finished, stuck or abandoned game is
+    // appended to the archive in directory dir.
+    bool setArchive(const char* dir, FsyncPolicy policy) {
+        archiving = archive.open(dir, policy, 1);
+        return archiving;
+    }
+
+    // Must be called before run(), after setLayout(); positions found in the
+    // enumeration in dir (tools/peg_bfs) are answered from it whenever the
+    // board and target match. False if they don't match now.
+    bool setWinDatabase(const char* dir) {
+        winDatabaseDir = dir;
+        return winDatabase.open(winDatabaseDir, engine, layoutKey(layout));
+    }
+
+    // Must be called before run(); counts heap allocations and shows them per
+    // frame and subsystem in a profiler window.
+    void setProfiling(bool on) {
+        profiling = on;
+        AllocTracker::setTracking(on);
+    }
+
+    // Must be called before run() or replay(); keeps the game logic on the
+    // render thread, inside the input callbacks, to compare latencies with.
+    void setSingleThreaded(bool on) {
+        singleThreaded = on;
+    }
+
+    // Must be called before run(), replay() and setRecording(); clicks act
+    // on the press rather than the release, and input is polled just before
+    // drawing and the GPU waited for after each swap (see awaitInput() and
+    // waitForGpu()). A replay acts on clicks as its log was recorded.
+    void setLowLatency(bool on) {
+        lowLatency = on;
+        clickOnPress = on;
+    }
+
+    // Must be called before run(): 0 turns vsync off, 1 syncs every swap to
+    // the display and -1 asks for adaptive vsync where the driver has it.
+    void setSwapInterval(int interval) {
+        swapInterval = interval;
+    }
+
+    void setRecordPath(const char* path) {
+        recordPath = path;
+    }
+
+    // Must be called before run().
+    void setLayout(const BoardLayout& l) {
+        useLayout(l);
+    }
+
+    // Must be called before run(); the game opens on puzzle first of list
+    // and N moves on to the next one.
+    bool setPuzzles(const std::vector<Puzzle>& list, int first) {
+        puzzles = list;
+        return first >= 0 && first < static_cast<int>(puzzles.size()) && loadPuzzle(first);
+    }
+
+    // Must be called before run(); every key and mouse button event is
+    // appended to the binary input log at path.
+    bool setRecording(const char* path) {
+        return recorder.open(path, clickOnPress ? INPUT_LOG_CLICK_ON_PRESS : 0);
+    }
+
+    // Renders frames into a hidden window with vsync off and returns the
+    // achieved frames per second, or a negative value without a GL context.
+    double benchmarkFrames(int frames) {
+        if (!initWindow(false)) return -1.0;
+        glfwSwapInterval(0);
+        double t0 = glfwGetTime();
+        for (int i = 0; i < frames; i++) {
+            presentFrame();
             glfwPollEvents();
         }
-        glfwTerminate();
+        glFinish();
+        double fps = frames / (glfwGetTime() - t0);
+        closeWindow();
+        return fps;
+    }
+
+    // Renders frames into a hidden window until the background services have
+    // settled, then the given number more with no input, and prints the
+    // heap allocations the render and game threads made in those by
+    // subsystem. Returns their number, or -1 without a GL context.
+    long long checkIdleAllocations(int frames) {
+        AllocTracker::setTracking(true);
+        if (!initWindow(false)) return -1;
+        AllocScope scope(ALLOC_FRAME);
+        glfwSwapInterval(0);
+        long long allocations = countIdleAllocations(frames, [this] {
+            presentFrame();
+            glfwPollEvents();
+        });
+        closeWindow();
+        return allocations;
+    }
+
+    // checkIdleAllocations() without a window: steps the game on this thread
+    // every SIM_TICK_MS and takes each snapshot as a frame would, so drawing
+    // isn't covered but no display or GL context is needed.
+    long long checkIdleSimulation(int steps) {
+        AllocTracker::setTracking(true);
+        AllocScope scope(ALLOC_GAME);
+        startServices();
+        startTime = clock.now();
+        publishSnapshot();
+        snapshots.update();
+        return countIdleAllocations(steps, [this] {
+            stepSimulation();
+            snapshots.update();
+            frameAllocs.endFrame(true);
+            std::this_thread::sleep_for(std::chrono::milliseconds(SIM_TICK_MS));
+        });
+    }
+
+    // Runs frame() until the background services have settled, then the
+    // given number of times more, and prints what the idle frames among
+    // those allocated on the render and game threads.
+    template <class Frame>
+    long long countIdleAllocations(int frames, Frame frame) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < WARMUP_FRAMES || (!servicesSettled() && std::chrono::steady_clock::now() - t0 < std::chrono::duration<double>(SETTLE_SECONDS)); i++)
+            frame();
+        AllocCounts before[ALLOC_SUBSYSTEMS];
+        for (int s = 0; s < ALLOC_SUBSYSTEMS; s++) before[s] = AllocTracker::total(s);
+        uint64_t idleBefore = frameAllocs.idleAllocations(), framesBefore = frameAllocs.idleFrames();
+        for (int i = 0; i < frames; i++) frame();
+        long long allocations = static_cast<long long>(frameAllocs.idleAllocations() - idleBefore);
+        printf("idle_frames %llu\n", static_cast<unsigned long long>(frameAllocs.idleFrames() - framesBefore));
+        printf("idle_allocations %lld\n", allocations);
+        for (int s = 0; s < ALLOC_SUBSYSTEMS; s++) {
+            AllocCounts t = AllocTracker::total(s);
+            printf("idle_allocations_%s %llu %llu bytes\n", allocSubsystemName(s), static_cast<unsigned long long>(t.count - before[s].count),
+                   static_cast<unsigned long long>(t.bytes - before[s].bytes));
+        }
+        return allocations;
+    }
+
+    // Feeds a recorded input log through the input queue live input uses,
+    // with the game clock pinned to the recorded timestamps. In realtime mode
+    // events are spaced as recorded; otherwise frames are rendered only
+    // until each event shows and vsync is off. Live input is ignored. Prints
+    // wall time, frames rendered and each event's latency to the frame that
+    // shows it (see presentFrame()), split into the time the game took to
+    // publish it and the time from there to the swap.
+    bool replay(const char* path, bool realtime, bool visible) {
+        std::vector<InputEvent> events;
+        uint16_t flags;
+        if (!InputRecorder::load(path, events, &flags)) return false;
+        // Clicks act as they did when recording, or the game would diverge.
+        clickOnPress = (flags & INPUT_LOG_CLICK_ON_PRESS) != 0;
+        if (clickOnPress != lowLatency)
+            std::fprintf(stderr, "'%s' was recorded %s --low-latency; clicks act on %s as they did then\n", path, clickOnPress ? "with" : "without",
+                         clickOnPress ? "press" : "release");
+        clickToPhoton = inputToState = stateToPresent = LatencyStats(events.size());
+        clock.set(0.0);
+        if (!initWindow(visible)) return false;
+        glfwSwapInterval(realtime ? 1 : 0);
+        int frames = 0;
+        std::chrono::steady_clock::time_point wall0 = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < events.size() && !glfwWindowShouldClose(window); i++) {
+            const InputEvent& e = events[i];
+            while (realtime) {
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+                if (elapsed >= e.time) break;
+                presentFrame();
+                glfwPollEvents();
+                frames++;
+            }
+            uint64_t seq = queueInput(e, true);
+            do {
+                if (lowLatency) awaitInput();
+                presentFrame();
+                glfwPollEvents();
+                frames++;
+            } while (presentedSeq < seq && !glfwWindowShouldClose(window));
+        }
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+        closeWindow();
+
+        printf("replay_events %llu\n", static_cast<unsigned long long>(queuedSeq));
+        printf("replay_frames %d\n", frames);
+        printf("replay_wall_s %f\n", wall);
+        printLatency("replay_latency_ms", clickToPhoton.summary());
+        printLatency("replay_input_to_state_ms", inputToState.summary());
+        printLatency("replay_state_to_present_ms", stateToPresent.summary());
+        return true;
     }
 
 private:
-    std::array<std::array<int, BOARD_SIZE>, BOARD_SIZE> board;
+    // Everything the render thread shows of the game, copied out by the game
+    // thread so that drawing never reads state it is changing. Published
+    // after every batch of input and every SIM_TICK_MS otherwise.
+    struct Snapshot {
+        uint64_t inputSeq;      // last input event applied
+        std::chrono::steady_clock::time_point published;
+        Bits pegs;
+        int numCells;
+        float cellSize, spanX, spanY;
+        float cellX[Engine::MAX_CELLS], cellY[Engine::MAX_CELLS];
+        int selected;           // engine cells, -1 for none
+        int hintFrom, hintTo;
+        int removed, marbles, moves;
+        bool stuck, won;
+        char layoutName[48];
+        const char* jumps;
+        double elapsed;
+        typename Analysis::Result solver;
+        bool solverCurrent;
+        int bestFromRow, bestFromCol, bestToRow, bestToCol;
+        typename SolutionCounts::Result count;
+        bool countCurrent;
+        SolutionCount solutions;    // of the position, once counted
+        typename Difficulty::Snapshot estimate;
+        char status[160];
+        LatencySummary inputLatency;    // input to state, kept while profiling
+    };
+
+    // An input event on its way from the callbacks to the game thread.
+    struct QueuedInput {
+        InputEvent event;
+        uint64_t seq;
+        std::chrono::steady_clock::time_point queued;
+        bool pinClock;          // replayed: run the game clock at event.time
+    };
+
+    static const std::size_t INPUT_QUEUE = 256;
+    static const int SIM_TICK_MS = 10;
+    static const int MAX_BATCH = 32;    // events applied per snapshot
+    static const int SWAP_DRIVER_DEFAULT = -2;
+    static const int INPUT_WAIT_US = 2000;
+    static const uint64_t FENCE_TIMEOUT_NS = 100000000;
+
+    BoardLayout layout;
+    float cellSize;
+    std::vector<float> cellX, cellY;    // cell centres in cellSize units, board centred on the origin
+    float spanX, spanY;             // extent of the board in cellSize units
+    std::vector<int> board;         // one entry per engine cell: 1 marble, 0 empty
     int initialEmptyRow;
     int initialEmptyCol;
+    int targetCell;                 // engine cell the last marble must finish in
     int selRow;
     int selCol;
-    std::stack<std::vector<int>> undoStack;
-    std::stack<std::vector<int>> redoStack;
+    int hintJump;
+    bool hintPending;
+    // A game has fewer moves than cells, so these are reserved at that size
+    // in useLayout() and never grow as it is played.
+    MoveHistory<Bits> history;      // since initBoard()
     std::vector<std::pair<int, int>> removedMarbles;
+    std::vector<Puzzle> puzzles;
+    int puzzleIndex;                // puzzle being played, -1 for a full board
+    Bits puzzleStart;
+    std::string recordPath;
+    bool profiling;
+    FrameAllocStats frameAllocs;
+    int inputEvents;                // queued since the last frame
+    // Render thread to game thread. The counters are each one thread's:
+    // queuedSeq and presentedSeq the render thread's, appliedSeq the game's.
+    SpscQueue<QueuedInput, INPUT_QUEUE> inputQueue;
+    TripleBuffer<Snapshot> snapshots;
+    uint64_t queuedSeq;
+    uint64_t presentedSeq;          // inputSeq of the snapshot last swapped in
+    uint64_t appliedSeq;
+    std::thread simThread;
+    std::mutex simMutex;
+    std::condition_variable simWake;
+    bool simStopping;               // guarded by simMutex
+    bool singleThreaded;
+    bool lowLatency;
+    bool clickOnPress;              // as lowLatency, but a replay's as recorded
+    int swapInterval;
+    std::chrono::steady_clock::time_point queuedAt[INPUT_QUEUE];   // by seq % INPUT_QUEUE
+    LatencyStats clickToPhoton;     // queued to shown, on the render thread
+    LatencyStats inputToState;      // queued to published, on the game thread
+    LatencyStats stateToPresent;    // published to shown, on the render thread
+    // Summaries for the profiler, redone only when samples arrive.
+    LatencySummary clickShown, presentShown;
+    LatencySummary inputShown;      // the game thread's
+    GameArchiveWriter archive;
+    bool archiving;
+    bool gameFinished;
+    double gameStartTime;
     int stepCounter;
-    std::string statusMessage;
+    char statusMessage[160];        // see setStatus()
     double startTime;
+    Engine engine;
+    Difficulty difficulty;
+    Analysis analysis;
+    BasicWinDatabase<Engine> winDatabase;  // open while it matches the layout
+    std::string winDatabaseDir;
+    SolutionCounts solutionCounts;
+    EventLog eventLog;
+    InputRecorder recorder;
+    GameClock clock;
 
     GLuint squareVAO, squareVBO;
     GLuint circleVAO, circleVBO;
@@ -73,7 +434,217 @@ private:
 
     GLFWwindow* window;
 
-    bool initGLFW() {
+    bool initWindow(bool visible) {
+        if (!initGLFW(visible)) return false;
+        glewExperimental = GL_TRUE;
+        glewInit();
+        InitImGui(window);
+        onInit();
+        startSimulation();
+        return true;
+    }
+
+    void closeWindow() {
+        stopSimulation();
+        glfwTerminate();
+    }
+
+    // Publishes the first snapshot, then hands the game over to its own
+    // thread unless single-threaded.
+    void startSimulation() {
+        publishSnapshot();
+        snapshots.update();
+        if (singleThreaded) return;
+        simStopping = false;
+        simThread = std::thread(&MarbleSolitaireGame::simulationLoop, this);
+    }
+
+    void stopSimulation() {
+        {
+            std::lock_guard<std::mutex> lock(simMutex);
+            simStopping = true;
+        }
+        simWake.notify_one();
+        if (simThread.joinable()) simThread.join();
+    }
+
+    // The game thread: applies input as it arrives and otherwise republishes
+    // every SIM_TICK_MS, so that the clock, the solver and the estimator
+    // keep moving on screen.
+    void simulationLoop() {
+        AllocScope scope(ALLOC_GAME);
+        std::unique_lock<std::mutex> lock(simMutex);
+        while (!simStopping) {
+            simWake.wait_for(lock, std::chrono::milliseconds(SIM_TICK_MS), [this] { return simStopping || !inputQueue.empty(); });
+            if (simStopping) break;
+            lock.unlock();
+            stepSimulation();
+            lock.lock();
+        }
+    }
+
+    // Render thread: hands an event to the game thread, or applies it on the
+    // spot when single-threaded. Returns the sequence number the snapshot
+    // showing its effect will carry.
+    uint64_t queueInput(const InputEvent& e, bool pinClock) {
+        QueuedInput q = {e, ++queuedSeq, std::chrono::steady_clock::now(), pinClock};
+        queuedAt[q.seq % INPUT_QUEUE] = q.queued;
+        while (!inputQueue.push(q)) std::this_thread::yield();
+        inputEvents++;
+        if (singleThreaded) stepSimulation();
+        else {
+            // Taking the lock orders the push before the game thread's
+            // check for input, so the wakeup can't be missed.
+            { std::lock_guard<std::mutex> lock(simMutex); }
+            simWake.notify_one();
+        }
+        return q.seq;
+    }
+
+    // Applies up to MAX_BATCH queued events, resolves a pending hint and
+    // publishes the result.
+    void stepSimulation() {
+        std::chrono::steady_clock::time_point queued[MAX_BATCH];
+        int n = 0;
+        QueuedInput q;
+        while (n < MAX_BATCH && inputQueue.pop(q)) {
+            const InputEvent& e = q.event;
+            if (q.pinClock) clock.set(e.time);
+            if (e.kind == INPUT_KEY) handleKey(e.code, e.scancode, e.action, e.mods);
+            else handleMouseButton(e.code, e.action, e.mods, e.x, e.y);
+            appliedSeq = q.seq;
+            queued[n++] = q.queued;
+        }
+        updateHint();
+        std::chrono::steady_clock::time_point published = publishSnapshot();
+        for (int i = 0; i < n; i++) inputToState.add(std::chrono::duration<double>(published - queued[i]).count());
+    }
+
+    // Returns the time it was published.
+    std::chrono::steady_clock::time_point publishSnapshot() {
+        Snapshot& s = snapshots.back();
+        Bits pegs = boardBits();
+        int n = engine.numCells();
+        s.inputSeq = appliedSeq;
+        s.pegs = pegs;
+        s.numCells = n;
+        s.cellSize = cellSize;
+        s.spanX = spanX;
+        s.spanY = spanY;
+        std::copy(cellX.begin(), cellX.begin() + n, s.cellX);
+        std::copy(cellY.begin(), cellY.begin() + n, s.cellY);
+        s.selected = selRow < 0 ? -1 : engine.cellIndex(selRow, selCol);
+        s.hintFrom = hintJump < 0 ? -1 : engine.jumps()[hintJump].from;
+        s.hintTo = hintJump < 0 ? -1 : engine.jumps()[hintJump].to;
+        s.removed = static_cast<int>(removedMarbles.size());
+        s.marbles = pegCount(pegs);
+        s.moves = countMoves(engine, history.played());
+        s.stuck = !engine.hasMoves(pegs);
+        s.won = engine.isWin(pegs, targetCell);
+        std::snprintf(s.layoutName, sizeof(s.layoutName), "%s", layout.name.c_str());
+        s.jumps = layout.grid == GRID_HEX ? "6 directions" : layout.rules == RULES_DIAGONAL ? "8 directions" : "orthogonal";
+        s.elapsed = clock.now() - startTime;
+        s.solver = analysis.snapshot();
+        s.solverCurrent = s.solver.generation == analysis.generation();
+        s.bestFromRow = s.bestFromCol = s.bestToRow = s.bestToCol = -1;
+        if (s.solver.status == SOLVE_WINNABLE && s.solver.bestMove >= 0) {
+            const Jump& j = engine.jumps()[s.solver.bestMove];
+            s.bestFromRow = engine.cellRow(j.from);
+            s.bestFromCol = engine.cellCol(j.from);
+            s.bestToRow = engine.cellRow(j.to);
+            s.bestToCol = engine.cellCol(j.to);
+        }
+        s.count = solutionCounts.snapshot();
+        s.countCurrent = s.count.generation == solutionCounts.generation();
+        s.solutions = s.countCurrent && s.count.status == COUNT_READY ? solutionCounts.solutions(pegs) : 0;
+        s.estimate = difficulty.snapshot();
+        std::memcpy(s.status, statusMessage, sizeof(s.status));
+        if (profiling && inputToState.count() != inputShown.count) inputShown = inputToState.summary();
+        s.inputLatency = inputShown;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        s.published = now;
+        snapshots.publish();
+        return now;
+    }
+
+    static void printLatency(const char* name, const LatencySummary& s) {
+        if (s.count) printf("%s mean %.3f p50 %.3f p99 %.3f max %.3f\n", name, 1e3 * s.mean, 1e3 * s.p50, 1e3 * s.p99, 1e3 * s.max);
+    }
+
+    static const int WARMUP_FRAMES = 120;
+    static constexpr double SETTLE_SECONDS = 30.0;
+
+    // Draws the latest snapshot. A frame is idle if no input was queued in
+    // it and its snapshot shows none that the last one didn't. Otherwise it
+    // is the first to show the events its snapshot newly applied, and their
+    // latency runs from the callback queuing them to the frame being shown:
+    // the swap returning, or with low latency on the GPU having finished it.
+    // GLFW doesn't timestamp events, and scanout after the swap can't be
+    // seen from here, so both ends are as close as the program can get.
+    void presentFrame() {
+        if (singleThreaded) {
+            AllocScope scope(ALLOC_GAME);
+            stepSimulation();
+        }
+        snapshots.update();
+        const Snapshot& s = snapshots.front();
+        glClear(GL_COLOR_BUFFER_BIT);
+        {
+            AllocScope scope(ALLOC_GAME);
+            onDisplay(s);
+        }
+        {
+            AllocScope scope(ALLOC_UI);
+            RenderImGui(s);
+        }
+        glfwSwapBuffers(window);
+        if (lowLatency) waitForGpu();
+        std::chrono::steady_clock::time_point shown = std::chrono::steady_clock::now();
+        bool applied = s.inputSeq != presentedSeq;
+        if (applied) {
+            stateToPresent.add(std::chrono::duration<double>(shown - s.published).count());
+            for (uint64_t q = presentedSeq + 1; q <= s.inputSeq; q++)
+                if (queuedSeq - q < INPUT_QUEUE) clickToPhoton.add(std::chrono::duration<double>(shown - queuedAt[q % INPUT_QUEUE]).count());
+            presentedSeq = s.inputSeq;
+            if (profiling) {
+                clickShown = clickToPhoton.summary();
+                presentShown = stateToPresent.summary();
+            }
+        }
+        frameAllocs.endFrame(inputEvents == 0 && !applied);
+        inputEvents = 0;
+    }
+
+    // Low latency, after polling: gives the game thread up to INPUT_WAIT_US
+    // to apply what was just queued, so the frame about to be drawn shows it
+    // rather than the next one.
+    void awaitInput() {
+        if (singleThreaded) return;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(INPUT_WAIT_US);
+        for (;;) {
+            snapshots.update();
+            if (snapshots.front().inputSeq == queuedSeq || std::chrono::steady_clock::now() >= deadline) return;
+            std::this_thread::yield();
+        }
+    }
+
+    // Low latency frame pacing: waits on a fence until the GPU has finished
+    // the frame just swapped, so the driver never queues frames ahead and
+    // the next one starts from the freshest input.
+    void waitForGpu() {
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+        glDeleteSync(fence);
+    }
+
+    // The solver and the solution counter have answered for the current
+    // position, so the panels stop changing shape.
+    bool servicesSettled() {
+        const Snapshot& s = snapshots.front();
+        return s.solverCurrent && s.solver.done && s.countCurrent && s.count.status != COUNT_RUNNING;
+    }
+
+    bool initGLFW(bool visible = true) {
         if (!glfwInit()) {
             std::fprintf(stderr, "GLFW initialization failed\n");
             return false;
@@ -83,6 +654,7 @@ private:
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
         glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+        glfwWindowHint(GLFW_VISIBLE, visible ? GL_TRUE : GL_FALSE);
         window = glfwCreateWindow(WindowWidth, WindowHeight, "Marble Solitaire", NULL, NULL);
         if (!window) {
             std::fprintf(stderr, "Failed to create GLFW window\n");
@@ -95,6 +667,7 @@ private:
 
     void InitImGui(GLFWwindow* win) {
         IMGUI_CHECKVERSION();
+        ImGui::SetAllocatorFunctions(imguiAlloc, imguiFree, nullptr);
         ImGui::CreateContext();
         ImGuiIO &io = ImGui::GetIO();
         (void)io;
@@ -109,143 +682,364 @@ private:
         CreateCircleVertexBuffer();
         CompileShaders();
         glDisable(GL_DEPTH_TEST);
+        startServices();
+        startTime = clock.now();
+        statusMessage[0] = 0;
+    }
+
+    // Starts the background services on the engine and sets up the board.
+    void startServices() {
+        difficulty.start(&engine);
+        analysis.start(&engine, &winDatabase);
+        solutionCounts.start(&engine);
         initBoard();
-        startTime = glfwGetTime();
-        statusMessage = "";
     }
 
     void initBoard() {
+        if (!history.played().empty() && !gameFinished) archiveGame(OUTCOME_ABANDONED);
+        gameFinished = false;
+        gameStartTime = clock.now();
         removedMarbles.clear();
-        for (std::size_t i = 0; i < board.size(); i++) {
-            for (std::size_t j = 0; j < board[i].size(); j++) {
-                if (isValidCell(static_cast<int>(i), static_cast<int>(j))) board[i][j] = 1;
-                else board[i][j] = -1;
+        Bits start = startBits();
+        board.assign(engine.numCells(), 0);
+        for (int i = 0; i < engine.numCells(); i++) board[i] = (start & Engine::bit(i)) ? 1 : 0;
+        history.reset(packBoard());
+        logEvent(EVENT_RESTART);
+        requestAnalysis();
+    }
+
+    // The position initBoard() sets up: the current puzzle's, or a full board
+    // but for the starting hole.
+    Bits startBits() const {
+        if (puzzleIndex >= 0) return puzzleStart;
+        return engine.fullBoard() ^ Engine::bit(engine.cellIndex(initialEmptyRow, initialEmptyCol));
+    }
+
+    // Sets up puzzle index of the loaded list in place of a full board,
+    // switching to its layout; false if that needs another engine or the
+    // puzzle doesn't match its board.
+    bool loadPuzzle(int index) {
+        const Puzzle& p = puzzles[index];
+        BoardLayout l;
+        if (!puzzleLayout(p, layout, l) || l.numCells() > Engine::MAX_CELLS) return false;
+        // Checked against the puzzle's own board before switching to it, so
+        // a bad puzzle leaves the game as it was.
+        bool other = l.name != layout.name || l.rules != layout.rules;
+        Engine e;
+        if (other) layoutEngine(l, e);
+        const Engine& check = other ? e : engine;
+        Bits pegs;
+        int target = check.cellIndex(p.targetRow, p.targetCol);
+        if (target < 0 || !puzzlePegs(check, p.picture, pegs)) return false;
+        if (other) useLayout(l, false);
+        puzzleIndex = index;
+        puzzleStart = pegs;
+        targetCell = target;
+        selRow = selCol = -1;
+        if (window) initBoard();
+        setStatus("Puzzle %d of %zu: finish in the winning cup in %d jumps.", index + 1, puzzles.size(), p.jumps);
+        return true;
+    }
+
+    void nextPuzzle() {
+        for (std::size_t k = 1; k <= puzzles.size(); k++)
+            if (loadPuzzle(static_cast<int>((puzzleIndex + k) % puzzles.size()))) return;
+        setStatus(puzzles.empty() ? "No puzzles loaded (see --puzzles)." : "No puzzle fits this board size.");
+    }
+
+    // Rebuilds the engine and everything sized from it. The background
+    // services hold a pointer to the engine, so they are stopped around the
+    // swap when running; the board is set up afresh unless the caller is
+    // about to do that itself.
+    void useLayout(const BoardLayout& l, bool setUp = true) {
+        bool running = window != nullptr;
+        if (running) {
+            if (!history.played().empty() && !gameFinished) archiveGame(OUTCOME_ABANDONED);
+            history.clear();
+            difficulty.stop();
+            analysis.stop();
+            solutionCounts.stop();
+        }
+        layout = l;
+        puzzleIndex = -1;
+        layoutEngine(layout, engine);
+        if (!winDatabaseDir.empty()) winDatabase.open(winDatabaseDir, engine, layoutKey(layout));
+        placeCells();
+        cellSize = std::min(CELL_SIZE, BOARD_EXTENT / std::max(spanX, spanY));
+        initialEmptyRow = layout.holeRow;
+        initialEmptyCol = layout.holeCol;
+        targetCell = engine.cellIndex(layout.targetRow, layout.targetCol);
+        selRow = selCol = -1;
+        board.assign(engine.numCells(), 0);
+        std::size_t most = engine.numCells() + 1;
+        history.reserve(most);
+        removedMarbles.reserve(most);
+        if (running) {
+            difficulty.start(&engine);
+            analysis.start(&engine, &winDatabase);
+            solutionCounts.start(&engine);
+            if (setUp) initBoard();
+        }
+    }
+
+    // Cycles through the standard layouts this engine's positions can hold.
+    void nextLayout() {
+        const std::vector<BoardLayout>& all = standardLayouts();
+        std::size_t next = 0;
+        for (std::size_t i = 0; i < all.size(); i++)
+            if (all[i].type == (layout.type & ~BOARD_DIAGONAL)) next = (i + 1) % all.size();
+        while (all[next].numCells() > Engine::MAX_CELLS) next = (next + 1) % all.size();
+        useLayout(withRules(all[next], layout.rules));
+    }
+
+    // Hex grid rows sit half a cell further left each and closer together,
+    // so the six jump directions are evenly spaced.
+    void placeCells() {
+        bool hex = engine.grid() == GRID_HEX;
+        int n = engine.numCells();
+        cellX.resize(n);
+        cellY.resize(n);
+        float minX = 0, maxX = 0, minY = 0, maxY = 0;
+        for (int i = 0; i < n; i++) {
+            cellX[i] = engine.cellCol(i) - (hex ? 0.5f * engine.cellRow(i) : 0.0f);
+            cellY[i] = -engine.cellRow(i) * (hex ? 0.8660254f : 1.0f);
+            minX = i == 0 ? cellX[i] : std::min(minX, cellX[i]);
+            maxX = i == 0 ? cellX[i] : std::max(maxX, cellX[i]);
+            minY = i == 0 ? cellY[i] : std::min(minY, cellY[i]);
+            maxY = i == 0 ? cellY[i] : std::max(maxY, cellY[i]);
+        }
+        for (int i = 0; i < n; i++) {
+            cellX[i] -= (minX + maxX) / 2;
+            cellY[i] -= (minY + maxY) / 2;
+        }
+        spanX = maxX - minX + 1;
+        spanY = maxY - minY + 1;
+    }
+
+    // Engine cell under the point, or -1: the enclosing square on a square
+    // grid, the nearest cup within half a cell on a hex one.
+    int cellAtPoint(float x, float y) {
+        bool hex = engine.grid() == GRID_HEX;
+        int best = -1;
+        float bestDist = hex ? 0.25f * cellSize * cellSize : 0.5f * cellSize;
+        for (int i = 0; i < engine.numCells(); i++) {
+            float dx = x - cellX[i] * cellSize, dy = y - cellY[i] * cellSize;
+            float d = hex ? dx * dx + dy * dy : std::max(std::fabs(dx), std::fabs(dy));
+            if (d < bestDist) {
+                best = i;
+                bestDist = d;
             }
         }
-        board[initialEmptyRow][initialEmptyCol] = 0;
-        while (!undoStack.empty()) undoStack.pop();
-        while (!redoStack.empty()) redoStack.pop();
-        undoStack.push(packBoard());
-        printMarbles();
+        return best;
     }
 
-    bool isValidCell(int i, int j) {
-        if (i < 0 || i >= BOARD_SIZE || j < 0 || j >= BOARD_SIZE) return false;
-        if (i == 0 || i == 1 || i == 5 || i == 6)  return (j >= 2 && j <= 4);
-        return true;
+    int cellAt(int r, int c) {
+        int i = engine.cellIndex(r, c);
+        return i < 0 ? -1 : board[i];
     }
 
-    std::vector<int> packBoard() {
-        std::vector<int> state;
-        state.reserve(BOARD_SIZE * BOARD_SIZE);
-        for (const auto& row : board) 
-            for (const auto& cell : row) 
-                state.push_back(cell);
-        return state;
+    Bits packBoard() {
+        return boardBits();
     }
 
-    void unpackBoard(const std::vector<int>& state) {
-        int idx = 0;
-        for (auto& row : board) 
-            for (auto& cell : row) 
-                cell = state[idx++];
+    void unpackBoard(Bits state) {
+        for (int i = 0; i < engine.numCells(); i++) board[i] = (state & Engine::bit(i)) ? 1 : 0;
     }
 
-    void printMarbles() {
+    void logEvent(LogEventType type, int sr = -1, int sc = -1, int dr = -1, int dc = -1) {
         stepCounter++;
-        int total = 0;
-        std::cout << "------------------------------------------\n";
-        std::cout << "Step #" << stepCounter << "\nMarbles on Board:\n";
-        for (std::size_t i = 0; i < board.size(); i++) {
-            for (std::size_t j = 0; j < board[i].size(); j++) {
-                if (isValidCell(static_cast<int>(i), static_cast<int>(j)) && board[i][j] == 1) {
-                    std::cout << "   (" << i << ", " << j << ")\n";
-                    total++;
-                }
-            }
+        if (!eventLog.enabled(LOG_INFO)) return;
+        LogEvent e;
+        e.board = lowWord(boardBits());
+        e.step = stepCounter;
+        e.pegs = static_cast<int16_t>(countMarbles());
+        e.removed = static_cast<int16_t>(removedMarbles.size());
+        e.fromRow = static_cast<int8_t>(sr);
+        e.fromCol = static_cast<int8_t>(sc);
+        e.toRow = static_cast<int8_t>(dr);
+        e.toCol = static_cast<int8_t>(dc);
+        e.type = static_cast<uint8_t>(type);
+        e.level = LOG_INFO;
+        eventLog.log(e);
+    }
+
+    Bits boardBits() {
+        Bits pegs = 0;
+        for (int i = 0; i < engine.numCells(); i++)
+            if (board[i] == 1) pegs |= Engine::bit(i);
+        return pegs;
+    }
+
+    // Status line text, formatted into a fixed buffer so that setting it
+    // doesn't allocate.
+    void setStatus(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        std::vsnprintf(statusMessage, sizeof(statusMessage), format, args);
+        va_end(args);
+    }
+
+    void requestAnalysis() {
+        Bits pegs = boardBits();
+        hintJump = -1;
+        hintPending = false;
+        difficulty.request(pegs, targetCell);
+        analysis.request(pegs, targetCell);
+        solutionCounts.request(startBits(), targetCell);
+    }
+
+    void requestHint() {
+        hintPending = true;
+        updateHint();
+        if (hintPending) setStatus("Looking for a hint...");
+    }
+
+    // Resolves a pending hint as soon as the solver has answered for the
+    // current position.
+    void updateHint() {
+        if (!hintPending) return;
+        typename Analysis::Result a = analysis.snapshot();
+        if (a.generation != analysis.generation() || !a.done) return;
+        hintPending = false;
+        if (a.status == SOLVE_WINNABLE && a.bestMove < 0) setStatus("Already solved.");
+        else if (a.status == SOLVE_WINNABLE) {
+            hintJump = a.bestMove;
+            setStatus("Hint: jump the highlighted marble.");
         }
-        std::cout << "Total Marbles: " << total << "\n";
-        std::cout << "Removed Marbles: " << removedMarbles.size() << "\n";
-        std::cout << "------------------------------------------\n";
+        else setStatus("No winning move from here.");
     }
 
     int countMarbles() {
-        int cnt = 0;
-        for (std::size_t i = 0; i < board.size(); i++) 
-            for (std::size_t j = 0; j < board[i].size(); j++) {
-                if (isValidCell(static_cast<int>(i), static_cast<int>(j)) && board[i][j] == 1) cnt++;
-            }
-        return cnt;
+        return pegCount(boardBits());
     }
 
     bool noPossibleMoves() {
-        static int dRow[4] = {-2, 2, 0, 0};
-        static int dCol[4] = {0, 0, -2, 2};
-        for (int r = 0; r < BOARD_SIZE; r++) 
-            for (int c = 0; c < BOARD_SIZE; c++) {
-                if (isValidCell(r, c) && board[r][c] == 1) {
-                    for (int k = 0; k < 4; k++) {
-                        int rr = r + dRow[k], cc = c + dCol[k];
-                        if (isValidCell(rr, cc) && board[rr][cc] == 0) {
-                            int jr = r + dRow[k] / 2, jc = c + dCol[k] / 2;
-                            if (isValidCell(jr, jc) && board[jr][jc] == 1) return false;
-                        }
-                    }
-                }
-            }
-        return true;
+        return !engine.hasMoves(boardBits());
     }
 
     bool checkWinCondition() {
-        return (noPossibleMoves() && countMarbles() == 1 && board[initialEmptyRow][initialEmptyCol] == 1);
+        return engine.isWin(boardBits(), targetCell);
     }
 
     bool isValidMove(int sr, int sc, int dr, int dc) {
-        if (!isValidCell(sr, sc) || !isValidCell(dr, dc)) return false;
-        int dRow = dr - sr, dCol = dc - sc;
-        if (!((std::abs(dRow) == 2 && dCol == 0) || (std::abs(dCol) == 2 && dRow == 0))) return false;
-        if (board[sr][sc] != 1 || board[dr][dc] != 0) return false;
-        int jr = sr + dRow / 2, jc = sc + dCol / 2;
-        if (!isValidCell(jr, jc) || board[jr][jc] != 1) return false;
-        return true;
+        int k = engine.findJump(sr, sc, dr, dc);
+        return k >= 0 && engine.isLegal(boardBits(), k);
     }
 
     void applyMove(int sr, int sc, int dr, int dc) {
-        int jr = sr + (dr - sr) / 2, jc = sc + (dc - sc) / 2;
-        board[sr][sc] = 0;
-        board[jr][jc] = 0;
-        board[dr][dc] = 1;
-        removedMarbles.push_back(std::make_pair(jr, jc));
-        undoStack.push(packBoard());
-        while (!redoStack.empty()) redoStack.pop();
-        statusMessage = "Move executed.";
-        printMarbles();
+        int k = engine.findJump(sr, sc, dr, dc);
+        const Jump& j = engine.jumps()[k];
+        board[j.from] = 0;
+        board[j.over] = 0;
+        board[j.to] = 1;
+        removedMarbles.push_back(std::make_pair(engine.cellRow(j.over), engine.cellCol(j.over)));
+        history.play(packBoard(), k);
+        setStatus("Move executed.");
+        logEvent(EVENT_MOVE, sr, sc, dr, dc);
+        if (checkWinCondition()) logEvent(EVENT_WIN);
+        if (noPossibleMoves()) {
+            archiveGame(checkWinCondition() ? OUTCOME_WON : OUTCOME_STUCK);
+            gameFinished = true;
+        }
+        requestAnalysis();
     }
 
     void undoMove() {
-        if (undoStack.size() <= 1) {
-            statusMessage = "No undo available.";
+        if (!history.undo()) {
+            setStatus("No undo available.");
             return;
         }
-        std::vector<int> current = undoStack.top();
-        undoStack.pop();
-        redoStack.push(current);
-        unpackBoard(undoStack.top());
-        statusMessage = "Undo applied.";
-        printMarbles();
+        unpackBoard(history.current());
+        gameFinished = false;
+        removedMarbles.pop_back();
+        setStatus("Undo applied.");
+        logEvent(EVENT_UNDO);
+        requestAnalysis();
     }
 
     void redoMove() {
-        if (redoStack.empty()) {
-            statusMessage = "No redo available.";
+        if (!history.redo()) {
+            setStatus("No redo available.");
             return;
         }
-        std::vector<int> state = redoStack.top();
-        redoStack.pop();
-        undoStack.push(state);
-        unpackBoard(state);
-        statusMessage = "Redo applied.";
-        printMarbles();
+        unpackBoard(history.current());
+        const Jump& j = engine.jumps()[history.played().back()];
+        removedMarbles.push_back(std::make_pair(engine.cellRow(j.over), engine.cellCol(j.over)));
+        setStatus("Redo applied.");
+        logEvent(EVENT_REDO);
+        requestAnalysis();
+    }
+
+    GameRecord currentRecord() {
+        GameRecord r;
+        r.boardType = layout.type;
+        r.bitsPerMove = static_cast<uint8_t>(moveBits(engine.numJumps()));
+        r.startHole = static_cast<uint8_t>(engine.cellIndex(initialEmptyRow, initialEmptyCol));
+        r.targetHole = static_cast<uint8_t>(targetCell);
+        r.moves.assign(history.played().begin(), history.played().end());
+        return r;
+    }
+
+    // Records start from a full board, so puzzles aren't archived or saved.
+    void archiveGame(GameOutcome outcome) {
+        if (!archiving || puzzleIndex >= 0) return;
+        ArchiveIndexEntry e;
+        e.endedAtMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+        e.durationMs = static_cast<uint32_t>(std::max(0.0, clock.now() - gameStartTime) * 1000.0);
+        e.pegsLeft = static_cast<uint8_t>(pegCount(boardBits()));
+        e.outcome = static_cast<uint8_t>(outcome);
+        archive.append(currentRecord(), e);
+    }
+
+    void saveGame() {
+        if (puzzleIndex >= 0) {
+            setStatus("Puzzles can't be saved; R starts this one over.");
+            return;
+        }
+        FILE* f = std::fopen(recordPath.c_str(), "wb");
+        if (!f) {
+            setStatus("Could not save %s.", recordPath.c_str());
+            return;
+        }
+        GameRecord r = currentRecord();
+        GameRecordWriter writer(f);
+        bool ok = writer.write(r);
+        ok = std::fclose(f) == 0 && ok;
+        setStatus(ok ? "Game saved to %s." : "Could not save %s.", recordPath.c_str());
+    }
+
+    void loadGame() {
+        FILE* f = std::fopen(recordPath.c_str(), "rb");
+        if (!f) {
+            setStatus("Could not open %s.", recordPath.c_str());
+            return;
+        }
+        GameRecordReader reader(f);
+        GameRecord r;
+        bool ok = reader.next(r);
+        std::fclose(f);
+        Bits pegs;
+        BoardLayout recorded;
+        if (ok && r.boardType != layout.type && layoutForType(r.boardType, recorded) && recorded.numCells() <= Engine::MAX_CELLS) useLayout(recorded);
+        if (!ok || r.boardType != layout.type || !replayRecord(engine, r, pegs)) {
+            setStatus("Invalid game record.");
+            return;
+        }
+        initialEmptyRow = engine.cellRow(r.startHole);
+        initialEmptyCol = engine.cellCol(r.startHole);
+        targetCell = r.targetHole;
+        puzzleIndex = -1;
+        selRow = selCol = -1;
+        initBoard();
+        // A loaded game was archived when it was played.
+        bool wasArchiving = archiving;
+        archiving = false;
+        for (std::size_t i = 0; i < r.moves.size(); i++) {
+            const Jump& j = engine.jumps()[r.moves[i]];
+            applyMove(engine.cellRow(j.from), engine.cellCol(j.from), engine.cellRow(j.to), engine.cellCol(j.to));
+        }
+        archiving = wasArchiving;
+        setStatus("Game loaded from %s.", recordPath.c_str());
     }
 
     void CreateSquareVertexBuffer() {
@@ -363,9 +1157,10 @@ private:
         glBindVertexArray(0);
     }
 
-    void drawBoard() {
-        float gridWidth = BOARD_SIZE * CELL_SIZE;
-        float gridHeight = BOARD_SIZE * CELL_SIZE;
+    void drawBoard(const Snapshot& s) {
+        float cellSize = s.cellSize;
+        float gridWidth = s.spanX * cellSize;
+        float gridHeight = s.spanY * cellSize;
         float boardScaleFactor = 1.1f;
         float boardWidth = gridWidth * boardScaleFactor;
         float boardHeight = gridHeight * boardScaleFactor;
@@ -376,70 +1171,85 @@ private:
         boardScale.InitScaleTransform(boardWidth, boardHeight, 1.0f);
         Matrix4f worldBoard = boardTrans * boardScale;
         renderSquare(worldBoard, woodenBoardColor);
-        float startX = -gridWidth / 2 + CELL_SIZE / 2;
-        float startY = gridHeight / 2 - CELL_SIZE / 2;
         Vector4f cupColor(0.12f, 0.12f, 0.12f, 1.0f);
         Vector4f marbleColor(0.9f, 0.9f, 0.9f, 1.0f);
         Vector4f selectedMarbleColor(0.5f, 0.5f, 0.5f, 1.0f);
-        for (int i = 0; i < BOARD_SIZE; i++) {
-            for (int j = 0; j < BOARD_SIZE; j++) {
-                if (!isValidCell(i, j)) continue;
-                float x = startX + j * CELL_SIZE;
-                float y = startY - i * CELL_SIZE;
-                Matrix4f trans;
-                trans.InitTranslationTransform(x, y, 0.0f);
-                Matrix4f cupScale;
-                cupScale.InitScaleTransform(CELL_SIZE, CELL_SIZE, 1.0f);
-                Matrix4f worldCup = trans * cupScale;
-                renderCircle(worldCup, cupColor);
-                if (board[i][j] == 1) {
-                    Matrix4f marbleScale;
-                    marbleScale.InitScaleTransform(CELL_SIZE * 0.8f, CELL_SIZE * 0.8f, 1.0f);
-                    Matrix4f worldMarble = trans * marbleScale;
-                    if (i == selRow && j == selCol) renderCircle(worldMarble, selectedMarbleColor);
-                    else renderCircle(worldMarble, marbleColor);
-                }
+        for (int cell = 0; cell < s.numCells; cell++) {
+            float x = s.cellX[cell] * cellSize;
+            float y = s.cellY[cell] * cellSize;
+            Matrix4f trans;
+            trans.InitTranslationTransform(x, y, 0.0f);
+            Matrix4f cupScale;
+            cupScale.InitScaleTransform(cellSize, cellSize, 1.0f);
+            Matrix4f worldCup = trans * cupScale;
+            renderCircle(worldCup, cupColor);
+            if (s.pegs & Engine::bit(cell)) {
+                Matrix4f marbleScale;
+                marbleScale.InitScaleTransform(cellSize * 0.8f, cellSize * 0.8f, 1.0f);
+                Matrix4f worldMarble = trans * marbleScale;
+                if (cell == s.selected || cell == s.hintFrom) renderCircle(worldMarble, selectedMarbleColor);
+                else renderCircle(worldMarble, marbleColor);
+            }
+            else if (cell == s.hintTo) {
+                Matrix4f hintScale;
+                hintScale.InitScaleTransform(cellSize * 0.4f, cellSize * 0.4f, 1.0f);
+                renderCircle(trans * hintScale, selectedMarbleColor);
             }
         }
     }
 
-    void drawRemovedMarbles() {
-        int count = removedMarbles.size();
+    void drawRemovedMarbles(const Snapshot& s) {
+        int count = s.removed;
         if (count == 0) return;
-        float boardWidth = BOARD_SIZE * CELL_SIZE;
-        float startX = -boardWidth / 2 + CELL_SIZE / 2;
-        float y = -(boardWidth / 2) - CELL_SIZE;
+        float cellSize = s.cellSize;
+        float boardWidth = s.spanX * cellSize;
+        float boardHeight = s.spanY * cellSize;
+        float startX = -boardWidth / 2 + cellSize / 2;
+        float y = -(boardHeight / 2) - cellSize;
         Vector4f removedColor(0.8f, 0.8f, 0.8f, 1.0f);
         for (int k = 0; k < count; k++) {
-            float x = startX + k * (CELL_SIZE * 0.9f);
+            float x = startX + k * (cellSize * 0.9f);
             Matrix4f trans;
             trans.InitTranslationTransform(x, y, 0.0f);
             Matrix4f scale;
-            scale.InitScaleTransform(CELL_SIZE * 0.6f, CELL_SIZE * 0.6f, 1.0f);
+            scale.InitScaleTransform(cellSize * 0.6f, cellSize * 0.6f, 1.0f);
             Matrix4f world = trans * scale;
             renderCircle(world, removedColor);
         }
     }
 
-    void onDisplay() {
+    void onDisplay(const Snapshot& s) {
         glClear(GL_COLOR_BUFFER_BIT);
-        drawBoard();
-        drawRemovedMarbles();
+        drawBoard(s);
+        drawRemovedMarbles(s);
         GLenum errorCode = glGetError();
         if (errorCode != GL_NO_ERROR) std::fprintf(stderr, "OpenGL rendering error %d\n", errorCode);
     }
 
+    // The callbacks run on the render thread and only record and queue the
+    // event; the game thread handles it.
     static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
         MarbleSolitaireGame* game = static_cast<MarbleSolitaireGame*>(glfwGetWindowUserPointer(window));
-        if (game) game->handleKey(key, scancode, action, mods);
+        if (!game) return;
+        InputEvent e = {game->clock.now() - game->startTime, INPUT_KEY, static_cast<uint8_t>(action), static_cast<uint8_t>(mods),
+                        static_cast<int16_t>(key), static_cast<int16_t>(scancode), 0.0f, 0.0f};
+        if (game->recorder.isOpen()) game->recorder.record(e);
+        game->queueInput(e, false);
     }
 
     static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
         MarbleSolitaireGame* game = static_cast<MarbleSolitaireGame*>(glfwGetWindowUserPointer(window));
-        if (game) game->handleMouseButton(button, action, mods);
+        if (!game) return;
+        double xpos, ypos;
+        glfwGetCursorPos(window, &xpos, &ypos);
+        InputEvent e = {game->clock.now() - game->startTime, INPUT_MOUSE_BUTTON, static_cast<uint8_t>(action), static_cast<uint8_t>(mods),
+                        static_cast<int16_t>(button), 0, static_cast<float>(xpos), static_cast<float>(ypos)};
+        if (game->recorder.isOpen()) game->recorder.record(e);
+        game->queueInput(e, false);
     }
 
     void handleKey(int key, int scancode, int action, int mods) {
+        AllocScope scope(ALLOC_INPUT);
         if (action == GLFW_PRESS) {
             switch (key) {
                 case GLFW_KEY_Q:
@@ -454,7 +1264,31 @@ private:
                     break;
                 case GLFW_KEY_R:
                     initBoard();
-                    statusMessage = "Board restarted.";
+                    setStatus("Board restarted.");
+                    break;
+                case GLFW_KEY_N:
+                    nextPuzzle();
+                    break;
+                case GLFW_KEY_H:
+                    requestHint();
+                    break;
+                case GLFW_KEY_S:
+                    saveGame();
+                    break;
+                case GLFW_KEY_L:
+                    loadGame();
+                    break;
+                case GLFW_KEY_B:
+                    nextLayout();
+                    setStatus("Board: %s.", layout.name.c_str());
+                    break;
+                case GLFW_KEY_D:
+                    if (layout.grid != GRID_SQUARE) {
+                        setStatus("Hex boards always jump in six directions.");
+                        break;
+                    }
+                    useLayout(withRules(layout, layout.rules == RULES_DIAGONAL ? RULES_ORTHOGONAL : RULES_DIAGONAL));
+                    setStatus(layout.rules == RULES_DIAGONAL ? "Diagonal jumps allowed." : "Orthogonal jumps only.");
                     break;
                 default:
                     break;
@@ -462,89 +1296,308 @@ private:
         }
     }
 
-    void handleMouseButton(int button, int action, int mods) {
-        if (action == GLFW_RELEASE) {
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
+    void handleMouseButton(int button, int action, int mods, double xpos, double ypos) {
+        AllocScope scope(ALLOC_INPUT);
+        if (action == (clickOnPress ? GLFW_PRESS : GLFW_RELEASE)) {
             float ndcX = (2.0f * static_cast<float>(xpos)) / WindowWidth - 1.0f;
             float ndcY = 1.0f - (2.0f * static_cast<float>(ypos)) / WindowHeight;
-            float boardWidth = BOARD_SIZE * CELL_SIZE;
-            float boardHeight = BOARD_SIZE * CELL_SIZE;
-            float startX = -boardWidth / 2;
-            float startY = boardHeight / 2;
-            int col = static_cast<int>((ndcX - startX) / CELL_SIZE);
-            int row = static_cast<int>((startY - ndcY) / CELL_SIZE);
-            if (!isValidCell(row, col)) return;
+            int picked = cellAtPoint(ndcX, ndcY);
+            if (picked < 0) return;
+            int row = engine.cellRow(picked), col = engine.cellCol(picked);
             if (button == GLFW_MOUSE_BUTTON_LEFT) {
                 if (selRow == -1 && selCol == -1) {
-                    if (board[row][col] == 1) {
+                    if (cellAt(row, col) == 1) {
                         selRow = row;
                         selCol = col;
-                        statusMessage = "Marble selected.";
+                        setStatus("Marble selected.");
                     }
                 } 
                 else {
-                    if (board[row][col] == 1) {
+                    if (cellAt(row, col) == 1) {
                         selRow = row;
                         selCol = col;
-                        statusMessage = "Selection changed.";
+                        setStatus("Selection changed.");
                     } 
                     else {
-                        int dRow = row - selRow, dCol = col - selCol;
-                        if (!((std::abs(dRow) == 2 && dCol == 0) || (std::abs(dCol) == 2 && dRow == 0))) statusMessage = "Invalid move: diagonal jump not allowed.";
+                        if (engine.findJump(selRow, selCol, row, col) < 0)
+                            setStatus(engine.grid() == GRID_SQUARE && engine.rules() == RULES_ORTHOGONAL ? "Invalid move: diagonal jump not allowed."
+                                                                                                        : "Invalid move: not a straight jump.");
                         else if (isValidMove(selRow, selCol, row, col)) applyMove(selRow, selCol, row, col);
-                        else statusMessage = "Invalid move.";
+                        else setStatus("Invalid move.");
                         selRow = selCol = -1;
                     }
                 }
             } 
             else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
-                if (!(row == initialEmptyRow && col == initialEmptyCol)) {
+                int cell = engine.cellIndex(row, col);
+                if (!(row == initialEmptyRow && col == initialEmptyCol && cell == targetCell)) {
                     initialEmptyRow = row;
                     initialEmptyCol = col;
+                    targetCell = cell;
+                    puzzleIndex = -1;
                     initBoard();
-                    statusMessage = "New winning cup set.";
+                    setStatus("New winning cup set.");
                 }
             }
         }
     }
 
-    void RenderImGui() {
+    void drawSolverStatus(const Snapshot& s) {
+        const typename Analysis::Result& a = s.solver;
+        ImGui::Separator();
+        if (!s.solverCurrent || (!a.done && a.nodes == 0)) {
+            ImGui::Text("Solver: thinking...");
+            return;
+        }
+        if (!a.done) {
+            ImGui::Text("Solver: %lluk nodes...", static_cast<unsigned long long>(a.nodes / 1000));
+            return;
+        }
+        if (a.status == SOLVE_WINNABLE) {
+            ImGui::TextColored(ImVec4(0, 1, 0, 1), "Winnable");
+            ImGui::Text("Best: (%d, %d) -> (%d, %d)", s.bestFromRow, s.bestFromCol, s.bestToRow, s.bestToCol);
+        }
+        else if (a.status == SOLVE_LOST) ImGui::TextColored(ImVec4(1, 0, 0, 1), "Not winnable");
+        ImGui::Text("Nodes searched: %llu", static_cast<unsigned long long>(a.nodes));
+        ImGui::Text("Solver memo peak: %.1f MB", a.memoPeak / 1048576.0);
+    }
+
+    // Counted once per start and target; every position after that is a
+    // table lookup.
+    void drawSolutionCount(const Snapshot& s) {
+        const typename SolutionCounts::Result& c = s.count;
+        if (!s.countCurrent || c.status == COUNT_RUNNING)
+            ImGui::Text("Solutions: counting (%lluk)...", static_cast<unsigned long long>(s.countCurrent ? c.expanded / 1000 : 0));
+        else if (c.status == COUNT_TOO_LARGE) ImGui::Text("Solutions: too many to count");
+        else {
+            char count[48];
+            ImGui::Text("Solutions: %s", formatCount(s.solutions, count));
+        }
+    }
+
+    void drawDifficulty(const Snapshot& s) {
+        const typename Difficulty::Snapshot& d = s.estimate;
+        ImGui::Separator();
+        if (d.playouts == 0) {
+            ImGui::Text("Difficulty: estimating...");
+            return;
+        }
+        double p = d.winRate();
+        const char* label = p >= 0.1 ? "Easy" : p >= 0.01 ? "Medium" : p >= 0.001 ? "Hard" : p > 0.0 ? "Very hard" : "No random win";
+        ImGui::Text("Difficulty: %s", label);
+        ImGui::Text("Win rate: %.3f%% of %lluk", 100.0 * p, static_cast<unsigned long long>(d.playouts / 1000));
+        float hist[Engine::MAX_CELLS];
+        int last = 1;
+        for (int i = 1; i <= Engine::MAX_CELLS; i++) {
+            hist[i - 1] = static_cast<float>(d.pegsLeft[i]);
+            if (d.pegsLeft[i]) last = i;
+        }
+        ImGui::PlotHistogram("##pegsleft", hist, last, 0, "Pegs left", 0.0f, FLT_MAX, ImVec2(0, 40));
+    }
+
+    // Heap allocations on the render and game threads by subsystem in the
+    // last frame and the worst one so far; background threads are shown for
+    // scale. Below them, input latencies over the last LatencyStats window
+    // (see presentFrame()).
+    void drawProfiler(const Snapshot& s) {
+        ImGui::SetNextWindowPos(ImVec2(10, 340), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(300, 250), ImGuiCond_Always);
+        ImGui::Begin("Profiler", NULL, ImGuiWindowFlags_NoResize);
+        ImGui::Text("%-8s %6s %9s %6s", "allocs", "frame", "bytes", "worst");
+        for (int s = 0; s < ALLOC_SUBSYSTEMS; s++) {
+            const AllocCounts& last = frameAllocs.lastFrame(s);
+            ImGui::Text("%-8s %6llu %9llu %6llu", allocSubsystemName(s), static_cast<unsigned long long>(last.count), static_cast<unsigned long long>(last.bytes),
+                        static_cast<unsigned long long>(frameAllocs.worstFrame(s).count));
+        }
+        ImGui::Text("Idle frames allocating: %llu of %llu", static_cast<unsigned long long>(frameAllocs.idleFramesAllocating()),
+                    static_cast<unsigned long long>(frameAllocs.idleFrames()));
+        ImGui::PlotLines("##allocs", frameAllocs.recent(), FrameAllocStats::HISTORY, frameAllocs.recentOffset(), NULL, 0.0f, FLT_MAX, ImVec2(280, 30));
+        ImGui::Separator();
+        ImGui::Text("%-16s %6s %6s %6s", "latency ms", "p50", "p99", "max");
+        drawLatency("click to photon", clickShown);
+        drawLatency("input to state", s.inputLatency);
+        drawLatency("state to present", presentShown);
+        if (swapInterval == SWAP_DRIVER_DEFAULT) ImGui::Text("%s, driver's swap interval", lowLatency ? "Low latency" : "Standard");
+        else ImGui::Text("%s, swap interval %d", lowLatency ? "Low latency" : "Standard", swapInterval);
+        ImGui::End();
+    }
+
+    static void drawLatency(const char* name, const LatencySummary& l) {
+        if (l.count == 0) ImGui::Text("%-16s %6s %6s %6s", name, "-", "-", "-");
+        else ImGui::Text("%-16s %6.2f %6.2f %6.2f", name, 1e3 * l.p50, 1e3 * l.p99, 1e3 * l.max);
+    }
+
+    void RenderImGui(const Snapshot& s) {
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
         ImGui::SetNextWindowPos(ImVec2(610, 10), ImGuiCond_Always);
-        ImGui::SetNextWindowSize(ImVec2(220, 160), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(220, 382), ImGuiCond_Always);
         ImGui::Begin("Info", NULL, ImGuiWindowFlags_NoResize);
-        double elapsed = glfwGetTime() - startTime;
-        ImGui::Text("Time: %.1f s", elapsed);
-        ImGui::Text("Remaining: %d", countMarbles());
+        ImGui::Text("Board: %s (%d)", s.layoutName, s.numCells);
+        ImGui::Text("Jumps: %s", s.jumps);
+        ImGui::Text("Time: %.1f s", s.elapsed);
+        ImGui::Text("Remaining: %d  Moves: %d", s.marbles, s.moves);
         ImGui::Text("U=Undo  Y=Redo");
-        ImGui::Text("R=Restart  Q=Quit");
+        ImGui::Text("R=Restart  Q=Quit  N=Puzzle");
+        ImGui::Text("H=Hint  S=Save  L=Load");
+        ImGui::Text("B=Next Board  D=Diagonals");
         ImGui::Text("L-Click: Select/Move");
         ImGui::Text("R-Click: Set Winning Cup");
-        if (noPossibleMoves()) {
-            if (checkWinCondition()) ImGui::TextColored(ImVec4(0, 1, 0, 1), "Game Won!");
+        if (s.stuck) {
+            if (s.won) ImGui::TextColored(ImVec4(0, 1, 0, 1), "Game Won in %d moves!", s.moves);
             else ImGui::TextColored(ImVec4(1, 0, 0, 1), "No moves left!");
         }
-        if (!statusMessage.empty()) {
+        drawSolverStatus(s);
+        drawSolutionCount(s);
+        drawDifficulty(s);
+        if (s.status[0]) {
             ImGui::Separator();
-            ImGui::TextWrapped("%s", statusMessage.c_str());
+            ImGui::TextWrapped("%s", s.status);
         }
         ImGui::End();
+        if (profiling) drawProfiler(s);
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
 
 public:
     void renderFrame() {
-        onDisplay();
-        RenderImGui();
+        onDisplay(snapshots.front());
+        RenderImGui(snapshots.front());
     }
 };
 
-int main(int argc, char *argv[]) {
-    MarbleSolitaireGame game;
+static bool parseLogLevel(const char* name, LogLevel& level) {
+    static const char* names[] = {"debug", "info", "warn", "error", "off"};
+    for (int i = 0; i <= LOG_OFF; i++)
+        if (std::strcmp(name, names[i]) == 0) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    return false;
+}
+
+static bool parseFsyncPolicy(const char* name, FsyncPolicy& policy) {
+    static const char* names[] = {"never", "batch", "always"};
+    for (int i = 0; i <= FSYNC_ALWAYS; i++)
+        if (std::strcmp(name, names[i]) == 0) {
+            policy = static_cast<FsyncPolicy>(i);
+            return true;
+        }
+    return false;
+}
+
+struct GameOptions {
+    BoardLayout layout;
+    LogLevel logLevel;
+    const char* logPath;
+    const char* recordPath;
+    const char* replayPath;
+    bool replayRealtime;
+    bool headless;
+    const char* gameFile;
+    const char* archiveDir;
+    FsyncPolicy archiveFsync;
+    int benchFrames;
+    std::vector<Puzzle> puzzles;
+    int puzzle;             // index into puzzles to open on
+    const char* winDatabase;
+    bool profile;
+    int allocCheckFrames;
+    int allocCheckSteps;    // --alloc-check-headless
+    bool singleThread;
+    bool lowLatency;
+    int swapInterval;       // -2: the driver's default
+};
+
+template <class Engine>
+int play(const GameOptions& o) {
+    MarbleSolitaireGame<Engine> game;
+    game.setLayout(o.layout);
+    game.setSingleThreaded(o.singleThread);
+    game.setLowLatency(o.lowLatency);
+    if (o.gameFile) game.setRecordPath(o.gameFile);
+    if (!game.setLogging(o.logLevel, o.logPath)) return 1;
+    if (!o.puzzles.empty() && !game.setPuzzles(o.puzzles, o.puzzle)) {
+        std::fprintf(stderr, "Puzzle %d doesn't match its board\n", o.puzzle + 1);
+        return 1;
+    }
+    if (o.winDatabase && !game.setWinDatabase(o.winDatabase))
+        std::fprintf(stderr, "'%s' holds no finished enumeration of %s; it is used only for boards it matches\n", o.winDatabase, layoutKey(o.layout).c_str());
+    if (o.allocCheckFrames > 0) {
+        long long n = game.checkIdleAllocations(o.allocCheckFrames);
+        return n == 0 ? 0 : 1;
+    }
+    if (o.allocCheckSteps > 0) return game.checkIdleSimulation(o.allocCheckSteps) == 0 ? 0 : 1;
+    if (o.benchFrames > 0) {
+        double fps = game.benchmarkFrames(o.benchFrames);
+        if (fps < 0.0) return 1;
+        printf("render_fps %f\n", fps);
+        return 0;
+    }
+    if (o.replayPath) return game.replay(o.replayPath, o.replayRealtime, !o.headless) ? 0 : 1;
+    if (o.recordPath && !game.setRecording(o.recordPath)) return 1;
+    if (o.archiveDir && !game.setArchive(o.archiveDir, o.archiveFsync)) return 1;
+    game.setProfiling(o.profile);
+    game.setSwapInterval(o.swapInterval);
     game.run();
     return 0;
 }
+
+int main(int argc, char *argv[]) {
+    GameOptions o = {*findLayout("english"), LOG_INFO, nullptr, nullptr, nullptr, true, false, nullptr, nullptr, FSYNC_NEVER, 0, std::vector<Puzzle>(), 0, nullptr, false, 0, 0, false, false, -2};
+    int rules = RULES_ORTHOGONAL;
+    for (int i = 1; i < argc; i++) {
+        bool more = i + 1 < argc;
+        if (std::strcmp(argv[i], "--bench-frames") == 0 && more) o.benchFrames = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--log") == 0 && more && parseLogLevel(argv[i + 1], o.logLevel)) i++;
+        else if (std::strcmp(argv[i], "--log-file") == 0 && more) o.logPath = argv[++i];
+        else if (std::strcmp(argv[i], "--record") == 0 && more) o.recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && more) o.replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay-fast") == 0) o.replayRealtime = false;
+        else if (std::strcmp(argv[i], "--headless") == 0) o.headless = true;
+        else if (std::strcmp(argv[i], "--game-file") == 0 && more) o.gameFile = argv[++i];
+        else if (std::strcmp(argv[i], "--archive") == 0 && more) o.archiveDir = argv[++i];
+        else if (std::strcmp(argv[i], "--archive-fsync") == 0 && more && parseFsyncPolicy(argv[i + 1], o.archiveFsync)) i++;
+        else if (std::strcmp(argv[i], "--board") == 0 && more && findLayout(argv[i + 1])) o.layout = *findLayout(argv[++i]);
+        else if (std::strcmp(argv[i], "--board-file") == 0 && more) {
+            if (!loadLayoutFile(argv[++i], o.layout)) return 1;
+        }
+        else if (std::strcmp(argv[i], "--puzzles") == 0 && more) {
+            if (!loadPuzzleFile(argv[++i], o.puzzles)) return 1;
+        }
+        else if (std::strcmp(argv[i], "--puzzle") == 0 && more) o.puzzle = std::atoi(argv[++i]) - 1;
+        else if (std::strcmp(argv[i], "--win-db") == 0 && more) o.winDatabase = argv[++i];
+        else if (std::strcmp(argv[i], "--profile") == 0) o.profile = true;
+        else if (std::strcmp(argv[i], "--alloc-check") == 0 && more) o.allocCheckFrames = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--alloc-check-headless") == 0 && more) o.allocCheckSteps = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--single-thread") == 0) o.singleThread = true;
+        else if (std::strcmp(argv[i], "--low-latency") == 0) o.lowLatency = true;
+        else if (std::strcmp(argv[i], "--swap-interval") == 0 && more) o.swapInterval = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--rules") == 0 && more && (!std::strcmp(argv[i + 1], "orthogonal") || !std::strcmp(argv[i + 1], "diagonal")))
+            rules = std::strcmp(argv[++i], "diagonal") == 0 ? RULES_DIAGONAL : RULES_ORTHOGONAL;
+        else {
+            std::fprintf(stderr, "usage: %s [--log debug|info|warn|error|off] [--log-file PATH] [--bench-frames N]\n"
+                                 "       [--record PATH] [--replay PATH [--replay-fast] [--headless]] [--game-file PATH]\n"
+                                 "       [--archive DIR [--archive-fsync never|batch|always]]\n"
+                                 "       [--board english|european|wiegleb|diamond|asymmetric|cross9|cross11|rectangle|\n"
+                                 "                triangle15|triangle21|hexagon37]\n"
+                                 "       [--board-file PATH] [--rules orthogonal|diagonal] [--puzzles PATH [--puzzle N]]\n"
+                                 "       [--win-db DIR] [--profile] [--alloc-check FRAMES] [--alloc-check-headless STEPS]\n"
+                                 "       [--single-thread] [--low-latency] [--swap-interval -1|0|1]\n", argv[0]);
+            return 1;
+        }
+    }
+    o.layout = withRules(o.layout, rules);
+    // A puzzle file picks the board (and so the engine) of the puzzle it
+    // opens on.
+    if (!o.puzzles.empty()) {
+        if (o.puzzle < 0 || o.puzzle >= static_cast<int>(o.puzzles.size()) || !puzzleLayout(o.puzzles[o.puzzle], o.layout, o.layout)) {
+            std::fprintf(stderr, "No puzzle %d or no board for it\n", o.puzzle + 1);
+            return 1;
+        }
+    }
+    // Boards of up to 64 cells keep the faster 64-bit engine.
+    return o.layout.numCells() > PegEngine::MAX_CELLS ? play<WidePegEngine>(o) : play<PegEngine>(o);
+}
@@ -0,0 +1,213 @@
+// Aggregate queries over a game archive written with --archive.
+//
+//   archive_query DIR [--board NAME|any] [--rules orthogonal|diagonal] [--start R,C]
+//                     [--outcome won|stuck|abandoned]
+//                     [--min-moves N] [--max-moves N]
+//                     [--min-secs S] [--max-secs S] [--games]
+//   archive_query DIR [--board NAME] [--rules R] --generate N [--fsync never|batch|always]
+//
+// Queries scan only the memory-mapped index files. --board defaults to
+// english; --rules picks the rule set the games on it were played with, and
+// --start is read on that board's grid. --games also decodes and
+// prints each matching record's moves. --generate appends N random games,
+// for trying out the archive at scale.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "board_layout.h"
+#include "game_archive.h"
+#include "peg_engine.h"
+#include "playout.h"
+
+struct Query {
+    int boardType;          // -1: any
+    int startHole;          // -1: any
+    int outcome;            // -1: any
+    int minMoves, maxMoves;
+    uint32_t minMs, maxMs;
+
+    bool matches(const ArchiveIndexEntry& e) const {
+        return (boardType < 0 || e.boardType == boardType) && (startHole < 0 || e.startHole == startHole) && (outcome < 0 || e.outcome == outcome) &&
+               e.moveCount >= minMoves && e.moveCount <= maxMoves && e.durationMs >= minMs && e.durationMs <= maxMs;
+    }
+};
+
+template <class Engine>
+static int generate(const std::string& dir, const BoardLayout& layout, uint64_t n, FsyncPolicy policy) {
+    Engine engine;
+    layoutEngine(layout, engine);
+    GameArchiveWriter writer;
+    if (!writer.open(dir, policy, 4096)) return 1;
+    std::vector<int> moves(engine.numJumps());
+    PegRng rng(static_cast<uint64_t>(time(nullptr)));
+    uint64_t now = static_cast<uint64_t>(time(nullptr)) * 1000;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        GameRecord r;
+        r.boardType = layout.type;
+        r.bitsPerMove = static_cast<uint8_t>(moveBits(engine.numJumps()));
+        r.startHole = r.targetHole = static_cast<uint8_t>(rng.below(engine.numCells()));
+        typename Engine::Bits pegs = engine.fullBoard() ^ Engine::bit(r.startHole);
+        for (;;) {
+            int count = engine.generateMoves(pegs, &moves[0]);
+            if (count == 0) break;
+            int m = moves[rng.below(count)];
+            r.moves.push_back(static_cast<uint16_t>(m));
+            pegs = engine.apply(pegs, m);
+        }
+        ArchiveIndexEntry e;
+        e.endedAtMs = now + i;
+        e.durationMs = static_cast<uint32_t>(r.moves.size() * (500 + rng.below(4000)));
+        e.pegsLeft = static_cast<uint8_t>(pegCount(pegs));
+        e.outcome = engine.isWin(pegs, r.targetHole) ? OUTCOME_WON : OUTCOME_STUCK;
+        writer.append(r, e);
+    }
+    writer.close();
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("appended %llu games in %.3f s (%.2f M/s)\n", static_cast<unsigned long long>(n), dt, n / dt / 1e6);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s DIR [--board NAME|any] [--rules orthogonal|diagonal] [--start R,C] [--outcome won|stuck|abandoned] [--min-moves N] [--max-moves N]\n"
+                        "       [--min-secs S] [--max-secs S] [--games] | --generate N [--fsync never|batch|always]\n", argv[0]);
+        return 2;
+    }
+    std::string dir = argv[1];
+    BoardLayout layout = *findLayout("english");
+    // Geometry only, so the wide engine serves every board.
+    WidePegEngine engine = layout.wideEngine();
+    Query q = {layout.type, -1, -1, 0, 255, 0, 0xffffffffu};
+    bool listGames = false;
+    uint64_t generateCount = 0;
+    FsyncPolicy policy = FSYNC_BATCH;
+    for (int i = 2; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--board" && more) {
+            std::string name = argv[++i];
+            if (name == "any") {
+                q.boardType = -1;
+                continue;
+            }
+            if (!findLayout(name)) {
+                fprintf(stderr, "Unknown board: '%s'\n", argv[i]);
+                return 2;
+            }
+            layout = withRules(*findLayout(name), layout.rules);
+            engine = layout.wideEngine();
+            q.boardType = layout.type;
+        }
+        else if (a == "--rules" && more) {
+            std::string rules = argv[++i];
+            if (rules != "orthogonal" && rules != "diagonal") {
+                fprintf(stderr, "Invalid rules: '%s'\n", argv[i]);
+                return 2;
+            }
+            layout = withRules(layout, rules == "diagonal" ? RULES_DIAGONAL : RULES_ORTHOGONAL);
+            engine = layout.wideEngine();
+            if (q.boardType >= 0) q.boardType = layout.type;
+        }
+        else if (a == "--start" && more) {
+            int r, c;
+            if (sscanf(argv[++i], "%d,%d", &r, &c) != 2 || (q.startHole = engine.cellIndex(r, c)) < 0) {
+                fprintf(stderr, "Invalid start hole: '%s'\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (a == "--outcome" && more) {
+            std::string o = argv[++i];
+            q.outcome = o == "won" ? OUTCOME_WON : o == "stuck" ? OUTCOME_STUCK : o == "abandoned" ? OUTCOME_ABANDONED : -2;
+            if (q.outcome == -2) {
+                fprintf(stderr, "Invalid outcome: '%s'\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (a == "--min-moves" && more) q.minMoves = atoi(argv[++i]);
+        else if (a == "--max-moves" && more) q.maxMoves = atoi(argv[++i]);
+        else if (a == "--min-secs" && more) q.minMs = static_cast<uint32_t>(atof(argv[++i]) * 1000);
+        else if (a == "--max-secs" && more) q.maxMs = static_cast<uint32_t>(atof(argv[++i]) * 1000);
+        else if (a == "--games") listGames = true;
+        else if (a == "--generate" && more) generateCount = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--fsync" && more) {
+            std::string p = argv[++i];
+            policy = p == "never" ? FSYNC_NEVER : p == "always" ? FSYNC_ALWAYS : FSYNC_BATCH;
+        }
+        else {
+            fprintf(stderr, "Unknown argument: '%s'\n", argv[i]);
+            return 2;
+        }
+    }
+    if (generateCount)
+        return layout.numCells() > PegEngine::MAX_CELLS ? generate<WidePegEngine>(dir, layout, generateCount, policy)
+                                                        : generate<PegEngine>(dir, layout, generateCount, policy);
+
+    GameArchiveReader archive;
+    if (!archive.open(dir)) {
+        fprintf(stderr, "No archive in '%s'\n", dir.c_str());
+        return 1;
+    }
+    uint64_t matched = 0, byOutcome[3] = {0, 0, 0}, moveSum = 0, msSum = 0, pegSum = 0;
+    uint64_t byStart[256] = {0};
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (std::size_t s = 0; s < archive.numSegments(); s++) {
+        uint64_t count;
+        const ArchiveIndexEntry* entries = archive.segmentEntries(s, count);
+        for (uint64_t i = 0; i < count; i++) {
+            const ArchiveIndexEntry& e = entries[i];
+            if (!q.matches(e)) continue;
+            matched++;
+            byOutcome[e.outcome < 3 ? e.outcome : 0]++;
+            byStart[e.startHole]++;
+            moveSum += e.moveCount;
+            msSum += e.durationMs;
+            pegSum += e.pegsLeft;
+        }
+    }
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("scanned %llu games in %.3f s (%.1f M/s)\n", static_cast<unsigned long long>(archive.size()), dt, dt > 0 ? archive.size() / dt / 1e6 : 0.0);
+    printf("matched %llu\n", static_cast<unsigned long long>(matched));
+    if (matched) {
+        printf("won %llu (%.2f%%), stuck %llu, abandoned %llu\n", static_cast<unsigned long long>(byOutcome[OUTCOME_WON]), 100.0 * byOutcome[OUTCOME_WON] / matched,
+               static_cast<unsigned long long>(byOutcome[OUTCOME_STUCK]), static_cast<unsigned long long>(byOutcome[OUTCOME_ABANDONED]));
+        printf("mean moves %.2f, mean pegs left %.2f, mean time %.1f s\n", double(moveSum) / matched, double(pegSum) / matched, msSum / 1000.0 / matched);
+        if (q.boardType >= 0) {
+            printf("by start hole:\n");
+            for (int h = 0; h < engine.numCells(); h++)
+                if (byStart[h]) printf("  (%d, %d) %llu\n", engine.cellRow(h), engine.cellCol(h), static_cast<unsigned long long>(byStart[h]));
+        }
+    }
+    if (listGames) {
+        // Engines for every standard board and rule set, so --board any can
+        // print too.
+        std::vector<WidePegEngine> engines(256);
+        for (std::size_t k = 0; k < standardLayouts().size(); k++)
+            for (int rules = RULES_ORTHOGONAL; rules <= RULES_DIAGONAL; rules++) {
+                BoardLayout l = withRules(standardLayouts()[k], rules);
+                engines[l.type] = l.wideEngine();
+            }
+        GameRecord r;
+        for (uint64_t i = 0; i < archive.size(); i++) {
+            if (!q.matches(archive.entry(i)) || !archive.record(i, r)) continue;
+            const WidePegEngine& e = engines[r.boardType];
+            printf("game %llu:", static_cast<unsigned long long>(i));
+            for (std::size_t k = 0; k < r.moves.size(); k++) {
+                if (r.moves[k] >= e.numJumps()) {
+                    printf(" #%d", r.moves[k]);
+                    continue;
+                }
+                const WidePegEngine::Jump& j = e.jumps()[r.moves[k]];
+                printf(" (%d,%d)-(%d,%d)", e.cellRow(j.from), e.cellCol(j.from), e.cellRow(j.to), e.cellCol(j.to));
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Enumerates every position reachable from a start into files, a peg count
+// at a time, then marks the winnable ones; the directory then serves as the
+// game's winnability database (--win-db).
+//
+//   peg_bfs --dir DIR [--board NAME | --board-file PATH] [--rules orthogonal|diagonal]
+//           [--start R,C] [--target R,C] [--mem-mb N] [--tmp-dir DIR]
+//           [--checkpoint-secs N] [--resume]
+//   peg_bfs --dir DIR --workers N [--board ...] [--rules ...] [--start R,C] [--target R,C]
+//
+// --mem-mb bounds the buffer sorted into each run (default 1024); runs go to
+// --tmp-dir, default DIR, and are removed once merged. The state is saved
+// after every layer and every --checkpoint-secs inside one (default 60, 0
+// for layer ends only); --resume carries on from the last save of a job on
+// the same board, after a crash or a kill as well.
+//
+// --workers splits the job over N processes that each hold a hash slice of
+// the layers in memory and trade positions through shared memory; the
+// output is the same, but a sharded run can't be resumed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+#include "board_layout.h"
+#include "external_bfs.h"
+#include "peg_engine.h"
+#include "sharded_bfs.h"
+
+static bool parseCell(const char* text, int& r, int& c) { return sscanf(text, "%d,%d", &r, &c) == 2; }
+
+struct BfsOptions {
+    std::string dir, tmpDir;
+    int startRow, startCol, targetRow, targetCol;
+    std::size_t memoryBytes;
+    double checkpointSeconds;
+    bool resume;
+    int workers;            // > 0: sharded over this many processes
+};
+
+template <class Engine>
+static void printLayers(const BoardLayout& layout, const std::string& dir, int top, double dt) {
+    uint64_t reach = 0, win = 0;
+    printf("pegs  reachable  winnable\n");
+    for (int n = top; n >= 1; n--) {
+        PositionReader<typename Engine::Bits> r, w;
+        uint64_t rn = r.open(bfsLayerPath(dir, "reach", n)) ? r.size() : 0, wn = w.open(bfsLayerPath(dir, "win", n)) ? w.size() : 0;
+        printf("%4d %10llu %9llu\n", n, static_cast<unsigned long long>(rn), static_cast<unsigned long long>(wn));
+        reach += rn;
+        win += wn;
+    }
+    printf("%s: %llu reachable positions, %llu winnable (up to symmetry, %.1f s)\n", layoutKey(layout).c_str(),
+           static_cast<unsigned long long>(reach), static_cast<unsigned long long>(win), dt);
+}
+
+template <class Engine>
+static int shard(const BoardLayout& layout, const Engine& engine, typename Engine::Bits pegs, int target, const BfsOptions& o) {
+    BasicShardedBfs<Engine> bfs(engine, o.dir, o.workers);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    double lastReport = 0.0;
+    bool ok = bfs.run(layoutKey(layout), pegs, target, [&](int n, uint64_t expanded) {
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (t - lastReport >= 1.0) {
+            fprintf(stderr, "%7.1f s  building layer %d  %llu positions expanded\n", t, n, static_cast<unsigned long long>(expanded));
+            lastReport = t;
+        }
+    });
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!ok) return 1;
+    printLayers<Engine>(layout, o.dir, pegCount(pegs), dt);
+    printf("worker   expanded       sent   stalls  peak held\n");
+    for (std::size_t w = 0; w < bfs.workerStats().size(); w++) {
+        const typename BasicShardedBfs<Engine>::WorkerStats& s = bfs.workerStats()[w];
+        printf("%6zu %10llu %10llu %8llu %10llu\n", w, static_cast<unsigned long long>(s.expanded), static_cast<unsigned long long>(s.sent),
+               static_cast<unsigned long long>(s.stalls), static_cast<unsigned long long>(s.peak));
+    }
+    return 0;
+}
+
+template <class Engine>
+static int enumerate(const BoardLayout& layout, const BfsOptions& o) {
+    Engine engine;
+    layoutEngine(layout, engine);
+    int hole = engine.cellIndex(o.startRow, o.startCol), target = engine.cellIndex(o.targetRow, o.targetCol);
+    if (hole < 0 || target < 0) {
+        fprintf(stderr, "Start and target must be holes of the board\n");
+        return 2;
+    }
+    if (o.workers > 0) return shard(layout, engine, engine.fullBoard() ^ Engine::bit(hole), target, o);
+    BasicExternalBfs<Engine> bfs(engine, o.dir, o.tmpDir.empty() ? o.dir : o.tmpDir, o.memoryBytes, o.checkpointSeconds);
+    if (o.resume ? !bfs.resume(layoutKey(layout)) : !bfs.start(layoutKey(layout), engine.fullBoard() ^ Engine::bit(hole), target)) return 2;
+    if (o.resume)
+        fprintf(stderr, "Resuming at reach layer %d, win layer %d, %llu positions in\n", bfs.progressState().reach, bfs.progressState().win,
+                static_cast<unsigned long long>(bfs.progressState().offset));
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    double lastReport = 0.0;
+    bool ok = bfs.run([&](int n, uint64_t read) {
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (t - lastReport >= 1.0) {
+            fprintf(stderr, "%7.1f s  building layer %d  %llu positions read\n", t, n, static_cast<unsigned long long>(read));
+            lastReport = t;
+        }
+        return true;
+    });
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!ok) return 1;
+    printLayers<Engine>(layout, o.dir, bfs.progressState().top(), dt);
+    printf("%llu checkpoints over the job, %.2f s writing them\n", static_cast<unsigned long long>(bfs.checkpoints()), bfs.checkpointSeconds());
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    BoardLayout layout = *findLayout("english");
+    int rules = RULES_ORTHOGONAL;
+    BfsOptions o = {std::string(), std::string(), -1, -1, -1, -1, ExternalBfs::MEMORY_BYTES, 60.0, false, 0};
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--board" && more) {
+            if (!findLayout(argv[++i])) {
+                fprintf(stderr, "Unknown board: '%s'\n", argv[i]);
+                return 2;
+            }
+            layout = *findLayout(argv[i]);
+        }
+        else if (a == "--board-file" && more) {
+            if (!loadLayoutFile(argv[++i], layout)) return 2;
+        }
+        else if (a == "--rules" && more) {
+            std::string r = argv[++i];
+            if (r != "orthogonal" && r != "diagonal") {
+                fprintf(stderr, "Invalid rules: '%s'\n", argv[i]);
+                return 2;
+            }
+            rules = r == "diagonal" ? RULES_DIAGONAL : RULES_ORTHOGONAL;
+        }
+        else if (a == "--start" && more) {
+            if (!parseCell(argv[++i], o.startRow, o.startCol)) {
+                fprintf(stderr, "Invalid start hole: '%s'\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (a == "--target" && more) {
+            if (!parseCell(argv[++i], o.targetRow, o.targetCol)) {
+                fprintf(stderr, "Invalid target hole: '%s'\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (a == "--dir" && more) o.dir = argv[++i];
+        else if (a == "--tmp-dir" && more) o.tmpDir = argv[++i];
+        else if (a == "--mem-mb" && more) o.memoryBytes = std::size_t(atoi(argv[++i])) << 20;
+        else if (a == "--checkpoint-secs" && more) o.checkpointSeconds = atof(argv[++i]);
+        else if (a == "--resume") o.resume = true;
+        else if (a == "--workers" && more) o.workers = atoi(argv[++i]);
+        else {
+            o.dir.clear();
+            break;
+        }
+    }
+    if (o.dir.empty()) {
+        fprintf(stderr, "usage: %s --dir DIR [--board NAME | --board-file PATH] [--rules orthogonal|diagonal] [--start R,C] [--target R,C]\n"
+                        "       [--mem-mb N] [--tmp-dir DIR] [--checkpoint-secs N] [--resume] | [--workers N]\n", argv[0]);
+        return 2;
+    }
+    layout = withRules(layout, rules);
+    if (o.startRow < 0) {
+        o.startRow = layout.holeRow;
+        o.startCol = layout.holeCol;
+    }
+    if (o.targetRow < 0) {
+        o.targetRow = layout.targetRow;
+        o.targetCol = layout.targetCol;
+    }
+    return layout.numCells() > PegEngine::MAX_CELLS ? enumerate<WidePegEngine>(layout, o) : enumerate<PegEngine>(layout, o);
+}
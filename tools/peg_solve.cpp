@@ -0,0 +1,220 @@
+// Fewest-move solutions, counting a run of jumps by one peg as one move.
+//
+//   peg_solve [--board NAME | --board-file PATH] [--rules orthogonal|diagonal]
+//             [--start R,C | --position ROW/ROW/...] [--target R,C]
+//             [--table-mb N] [--live-mb N] [--count]
+//             [--meet [--mem-mb N]] [--spill-dir DIR] [--checkpoint-secs N [--resume]]
+//
+// --start and --target default to the layout's own holes; --position starts
+// from any position instead, drawn as in a puzzle file. Progress goes to
+// stderr about once a second; the moves of one optimal line go to stdout.
+// --count prints the number of distinct jump sequences that solve the game
+// instead, and --meet only decides whether it can be solved at all, meeting
+// in the middle with its layers on disk in DIR.
+//
+// Long searches (--meet, and the bounded search the fewest-move solver falls
+// back on when the live positions don't fit) checkpoint to DIR every
+// --checkpoint-secs; run the same command with --resume to continue from
+// the last checkpoint after the job was killed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+#include "bidirectional_solver.h"
+#include "board_layout.h"
+#include "move_solver.h"
+#include "peg_engine.h"
+#include "puzzle.h"
+#include "solution_count.h"
+
+static bool parseCell(const char* text, int& r, int& c) { return sscanf(text, "%d,%d", &r, &c) == 2; }
+
+struct SolveOptions {
+    int startRow, startCol, targetRow, targetCol;
+    std::string position;   // puzzle picture, or empty for the single-hole start
+    std::size_t tableBytes, liveBytes, memoryBytes;
+    bool counting, meet;
+    std::string spillDir;
+    double checkpointSeconds;
+    bool resume;
+};
+
+static void reportCheckpoints(uint64_t count, double seconds, double total) {
+    if (count) fprintf(stderr, "%llu checkpoints, %.2f s writing them (%.1f%% of the run)\n", static_cast<unsigned long long>(count), seconds,
+                       total > 0.0 ? 100.0 * seconds / total : 0.0);
+}
+
+template <class Engine>
+static void printLine(const Engine& engine, const std::vector<int>& line) {
+    int move = 0, last = -1;
+    for (std::size_t i = 0; i < line.size(); i++) {
+        const typename Engine::Jump& j = engine.jumps()[line[i]];
+        if (j.from != last) {
+            if (move) printf("\n");
+            printf("%3d: (%d, %d)", ++move, engine.cellRow(j.from), engine.cellCol(j.from));
+        }
+        printf(" -> (%d, %d)", engine.cellRow(j.to), engine.cellCol(j.to));
+        last = j.to;
+    }
+    printf("\n");
+}
+
+template <class Engine>
+static int meet(const BoardLayout& layout, typename Engine::Bits pegs, int target, const Engine& engine, const SolveOptions& o) {
+    BasicBidirectionalSolver<Engine> solver(engine, o.spillDir, o.memoryBytes);
+    solver.setCheckpoint(o.checkpointSeconds, o.resume);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    double lastReport = 0.0;
+    SolveStatus status = solver.solve(pegs, target, [&](int n, uint64_t expanded) {
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (t - lastReport >= 1.0) {
+            fprintf(stderr, "%7.1f s  layer %d  %llu positions expanded\n", t, n, static_cast<unsigned long long>(expanded));
+            lastReport = t;
+        }
+        return true;
+    });
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    reportCheckpoints(solver.checkpoints(), solver.checkpointSeconds(), dt);
+    if (status == SOLVE_UNKNOWN) return 2;
+    printf("%s: %s to (%d, %d) (%llu positions expanded, at most %zu in memory, %llu spilled, %.1f s)\n", layout.name.c_str(),
+           status == SOLVE_WINNABLE ? "solvable" : "no solution", engine.cellRow(target), engine.cellCol(target),
+           static_cast<unsigned long long>(solver.expandedCount()), solver.peakPositions(),
+           static_cast<unsigned long long>(solver.spilledPositions()), dt);
+    if (status != SOLVE_WINNABLE) return 1;
+    printLine(engine, solver.solution());
+    return 0;
+}
+
+template <class Engine>
+static int count(const BoardLayout& layout, typename Engine::Bits pegs, int target, const Engine& engine, std::size_t liveBytes) {
+    BasicSolutionCounter<Engine> counter(engine, liveBytes);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    double lastReport = 0.0;
+    bool ok = counter.count(pegs, target, [&](uint64_t n) {
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (t - lastReport >= 1.0) {
+            fprintf(stderr, "%7.1f s  %llu positions expanded\n", t, static_cast<unsigned long long>(n));
+            lastReport = t;
+        }
+        return true;
+    });
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!ok) {
+        fprintf(stderr, "The live positions don't fit in %zu MB (raise --live-mb)\n", liveBytes >> 20);
+        return 1;
+    }
+    printf("%s: %s solutions to (%d, %d) (%zu live positions, %zu MB, %.1f s)\n", layout.name.c_str(), formatCount(counter.solutions(pegs)).c_str(),
+           engine.cellRow(target), engine.cellCol(target), counter.positions(), counter.bytes() >> 20, dt);
+    return 0;
+}
+
+template <class Engine>
+static int solve(const BoardLayout& layout, const SolveOptions& o) {
+    Engine engine;
+    layoutEngine(layout, engine);
+    int hole = engine.cellIndex(o.startRow, o.startCol), target = engine.cellIndex(o.targetRow, o.targetCol);
+    if (hole < 0 || target < 0) {
+        fprintf(stderr, "Start and target must be holes of the board\n");
+        return 2;
+    }
+    typename Engine::Bits pegs = engine.fullBoard() ^ Engine::bit(hole);
+    if (!o.position.empty() && !puzzlePegs(engine, o.position, pegs)) {
+        fprintf(stderr, "The position doesn't match the board: '%s'\n", o.position.c_str());
+        return 2;
+    }
+    if (o.meet) return meet(layout, pegs, target, engine, o);
+    if (o.counting) return count(layout, pegs, target, engine, o.liveBytes);
+    BasicMinMoveSolver<Engine> solver(engine, o.tableBytes, o.liveBytes);
+    solver.setCheckpoint(o.spillDir + "/solve.state", o.checkpointSeconds, o.resume);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    double lastReport = 0.0;
+    int lastBound = -1;
+    int moves = solver.solve(pegs, target, [&](int bound, uint64_t nodes) {
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (bound != lastBound || t - lastReport >= 1.0) {
+            if (bound) fprintf(stderr, "%7.1f s  bound %d  %llu nodes\n", t, bound, static_cast<unsigned long long>(nodes));
+            else fprintf(stderr, "%7.1f s  finding live positions  %llu nodes\n", t, static_cast<unsigned long long>(nodes));
+            lastBound = bound;
+            lastReport = t;
+        }
+        return true;
+    });
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    reportCheckpoints(solver.checkpoints(), solver.checkpointSeconds(), dt);
+    if (moves < 0) {
+        printf("%s: no solution to (%d, %d) (%.1f s)\n", layout.name.c_str(), o.targetRow, o.targetCol, dt);
+        return 1;
+    }
+    printf("%s: %d moves to (%d, %d) (%llu nodes, %.1f s)\n", layout.name.c_str(), moves, o.targetRow, o.targetCol,
+           static_cast<unsigned long long>(solver.nodes()), dt);
+    printLine(engine, solver.solution());
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    BoardLayout layout = *findLayout("english");
+    int rules = RULES_ORTHOGONAL;
+    SolveOptions o = {-1, -1, -1, -1, std::string(), MinMoveSolver::TABLE_BYTES, MinMoveSolver::LIVE_BYTES, BidirectionalSolver::MEMORY_BYTES,
+                      false, false, ".", 0.0, false};
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--board" && more) {
+            if (!findLayout(argv[++i])) {
+                fprintf(stderr, "Unknown board: '%s'\n", argv[i]);
+                return 2;
+            }
+            layout = *findLayout(argv[i]);
+        }
+        else if (a == "--board-file" && more) {
+            if (!loadLayoutFile(argv[++i], layout)) return 2;
+        }
+        else if (a == "--rules" && more) {
+            std::string r = argv[++i];
+            if (r != "orthogonal" && r != "diagonal") {
+                fprintf(stderr, "Invalid rules: '%s'\n", argv[i]);
+                return 2;
+            }
+            rules = r == "diagonal" ? RULES_DIAGONAL : RULES_ORTHOGONAL;
+        }
+        else if (a == "--start" && more) {
+            if (!parseCell(argv[++i], o.startRow, o.startCol)) {
+                fprintf(stderr, "Invalid start hole: '%s'\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (a == "--target" && more) {
+            if (!parseCell(argv[++i], o.targetRow, o.targetCol)) {
+                fprintf(stderr, "Invalid target hole: '%s'\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (a == "--position" && more) o.position = argv[++i];
+        else if (a == "--table-mb" && more) o.tableBytes = std::size_t(atoi(argv[++i])) << 20;
+        else if (a == "--live-mb" && more) o.liveBytes = std::size_t(atoi(argv[++i])) << 20;
+        else if (a == "--count") o.counting = true;
+        else if (a == "--meet") o.meet = true;
+        else if (a == "--spill-dir" && more) o.spillDir = argv[++i];
+        else if (a == "--mem-mb" && more) o.memoryBytes = std::size_t(atoi(argv[++i])) << 20;
+        else if (a == "--checkpoint-secs" && more) o.checkpointSeconds = atof(argv[++i]);
+        else if (a == "--resume") o.resume = true;
+        else {
+            fprintf(stderr, "usage: %s [--board NAME | --board-file PATH] [--rules orthogonal|diagonal]\n"
+                            "       [--start R,C | --position ROW/ROW/...] [--target R,C] [--table-mb N] [--live-mb N] [--count]\n"
+                            "       [--meet [--mem-mb N]] [--spill-dir DIR] [--checkpoint-secs N [--resume]]\n", argv[0]);
+            return 2;
+        }
+    }
+    layout = withRules(layout, rules);
+    if (o.startRow < 0) {
+        o.startRow = layout.holeRow;
+        o.startCol = layout.holeCol;
+    }
+    if (o.targetRow < 0) {
+        o.targetRow = layout.targetRow;
+        o.targetCol = layout.targetCol;
+    }
+    return layout.numCells() > PegEngine::MAX_CELLS ? solve<WidePegEngine>(layout, o) : solve<PegEngine>(layout, o);
+}
@@ -0,0 +1,232 @@
+// Generates puzzles: mid-game positions with exactly one solution.
+//
+//   puzzle_gen [--board NAME | --board-file PATH] [--rules orthogonal|diagonal]
+//              [--target R,C] [--jumps N] [--count N] [--threads N] [--seed S]
+//              [--out PATH]
+//
+// Each worker undoes --jumps random jumps back from a single peg on the target
+// (default: the layout's target hole), counting the solutions of every
+// candidate along the way and only stepping to one with exactly one; a walk
+// that runs out of such steps starts over. Symmetric copies of a kept puzzle
+// are skipped. Puzzles are appended to --out (default
+// puzzles.txt) as they are found, in the format of puzzle.h; progress goes to
+// stderr about once a second. Boards and jump counts with fewer puzzles than
+// --count run dry: once GIVE_UP walks in a row have ended early or found only
+// puzzles already written, the generator stops with what it has and exits 1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board_layout.h"
+#include "peg_engine.h"
+#include "playout.h"
+#include "puzzle.h"
+#include "solution_count.h"
+
+struct GenOptions {
+    BoardLayout layout;
+    int targetRow, targetCol;
+    int jumps;
+    uint64_t count;
+    int threads;
+    uint64_t seed;
+    const char* outPath;
+};
+
+template <class Engine>
+class PuzzleGenerator {
+public:
+    typedef typename Engine::Bits Bits;
+
+    // Candidates are small, so each worker's counter needs little room.
+    static const std::size_t LIVE_BYTES = std::size_t(64) << 20;
+    static const uint64_t GIVE_UP = 2000;
+
+    PuzzleGenerator(const GenOptions& o, FILE* f) : opts(o), out(f), produced(0), tried(0), fruitless(0), lastTime(0.0), lastProduced(0) {
+        layoutEngine(o.layout, engine);
+        target = engine.cellIndex(o.targetRow, o.targetCol);
+        for (int s = 1; s < engine.numSymmetries(); s++)
+            if (engine.symmetryCell(s, target) == target) stabilizer.push_back(s);
+    }
+
+    int run() {
+        if (target < 0) {
+            fprintf(stderr, "The target must be a hole of the board\n");
+            return 2;
+        }
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int i = 0; i < opts.threads; i++) workers.push_back(std::thread(&PuzzleGenerator::work, this, opts.seed + i));
+        for (int tick = 1; !done(); tick++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (tick % 10 == 0) report(t0);
+        }
+        for (std::size_t i = 0; i < workers.size(); i++) workers[i].join();
+        report(t0);
+        if (produced.load() < opts.count) {
+            fprintf(stderr, "Gave up after %llu walks in a row found nothing new: wrote %llu of %llu puzzles\n",
+                    static_cast<unsigned long long>(GIVE_UP), static_cast<unsigned long long>(produced.load()),
+                    static_cast<unsigned long long>(opts.count));
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    bool done() const { return produced.load(std::memory_order_relaxed) >= opts.count || fruitless.load(std::memory_order_relaxed) >= GIVE_UP; }
+
+    // The rate is over the time since the last report: it falls as the walks
+    // keep finding puzzles already written.
+    void report(std::chrono::steady_clock::time_point t0) {
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        uint64_t n = produced.load();
+        fprintf(stderr, "%7.1f s  %llu puzzles from %llu candidates (%.0f per minute)\n", t, static_cast<unsigned long long>(n),
+                static_cast<unsigned long long>(tried.load()), t > lastTime ? 60.0 * (n - lastProduced) / (t - lastTime) : 0.0);
+        lastTime = t;
+        lastProduced = n;
+    }
+
+    Bits canonical(Bits pegs) const {
+        Bits best = pegs;
+        for (std::size_t i = 0; i < stabilizer.size(); i++) {
+            Bits p = engine.transform(pegs, stabilizer[i]);
+            if (p < best) best = p;
+        }
+        return best;
+    }
+
+    void work(uint64_t seed) {
+        BasicSolutionCounter<Engine> counter(engine, LIVE_BYTES);
+        PegRng rng(seed * 0x9E3779B97F4A7C15ULL + 1);
+        int moves[Engine::MAX_CELLS * GridSteps::MAX_DIRECTIONS];
+        while (!done()) {
+            // Undoes one jump at a time, keeping the solution unique all the
+            // way: a jump can be undone exactly when it could be played on
+            // the complement of the position.
+            Bits pegs = Engine::bit(target);
+            int k = 0;
+            while (k < opts.jumps) {
+                int n = engine.generateMoves(engine.fullBoard() ^ pegs, moves);
+                int first = n ? rng.below(n) : 0, i = 0;
+                for (; i < n; i++) {
+                    Bits p = engine.apply(pegs, moves[(first + i) % n]);
+                    tried.fetch_add(1, std::memory_order_relaxed);
+                    if (counter.count(p, target) && counter.solutions(p) == 1) {
+                        pegs = p;
+                        k++;
+                        break;
+                    }
+                }
+                if (i == n) break;
+            }
+            if (k < opts.jumps) {
+                fruitless.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (produced.load(std::memory_order_relaxed) >= opts.count) continue;
+            if (!seen.insert(canonical(pegs)).second) {
+                fruitless.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            fruitless.store(0, std::memory_order_relaxed);
+            Puzzle p;
+            p.board = opts.layout.name;
+            p.rules = opts.layout.rules;
+            p.targetRow = opts.targetRow;
+            p.targetCol = opts.targetCol;
+            p.jumps = opts.jumps;
+            p.picture = puzzlePicture(engine, pegs);
+            fprintf(out, "%s\n", formatPuzzle(p).c_str());
+            fflush(out);
+            produced.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    const GenOptions& opts;
+    Engine engine;
+    int target;
+    std::vector<int> stabilizer;    // symmetries other than the identity that fix target
+    FILE* out;
+    std::mutex mutex;               // guards seen and out
+    std::set<Bits> seen;            // canonical puzzles written
+    std::atomic<uint64_t> produced, tried;
+    std::atomic<uint64_t> fruitless;    // walks in a row that found no new puzzle
+    double lastTime;                    // of the last report, for its rate
+    uint64_t lastProduced;
+};
+
+int main(int argc, char* argv[]) {
+    GenOptions o = {*findLayout("english"), -1, -1, 8, 1000, static_cast<int>(std::thread::hardware_concurrency()), static_cast<uint64_t>(time(nullptr)), "puzzles.txt"};
+    int rules = RULES_ORTHOGONAL;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--board" && more) {
+            if (!findLayout(argv[++i])) {
+                fprintf(stderr, "Unknown board: '%s'\n", argv[i]);
+                return 2;
+            }
+            o.layout = *findLayout(argv[i]);
+        }
+        else if (a == "--board-file" && more) {
+            if (!loadLayoutFile(argv[++i], o.layout)) return 2;
+        }
+        else if (a == "--rules" && more) {
+            std::string r = argv[++i];
+            if (r != "orthogonal" && r != "diagonal") {
+                fprintf(stderr, "Invalid rules: '%s'\n", argv[i]);
+                return 2;
+            }
+            rules = r == "diagonal" ? RULES_DIAGONAL : RULES_ORTHOGONAL;
+        }
+        else if (a == "--target" && more) {
+            if (sscanf(argv[++i], "%d,%d", &o.targetRow, &o.targetCol) != 2) {
+                fprintf(stderr, "Invalid target hole: '%s'\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (a == "--jumps" && more) o.jumps = atoi(argv[++i]);
+        else if (a == "--count" && more) o.count = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--threads" && more) o.threads = atoi(argv[++i]);
+        else if (a == "--seed" && more) o.seed = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--out" && more) o.outPath = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--board NAME | --board-file PATH] [--rules orthogonal|diagonal] [--target R,C] [--jumps N]\n"
+                            "       [--count N] [--threads N] [--seed S] [--out PATH]\n", argv[0]);
+            return 2;
+        }
+    }
+    o.layout = withRules(o.layout, rules);
+    if (o.targetRow < 0) {
+        o.targetRow = o.layout.targetRow;
+        o.targetCol = o.layout.targetCol;
+    }
+    if (o.jumps < 1 || o.jumps >= o.layout.numCells() || o.threads < 1) {
+        fprintf(stderr, "Need 1 <= jumps < holes and at least one thread\n");
+        return 2;
+    }
+    FILE* f = fopen(o.outPath, "w");
+    if (!f) {
+        fprintf(stderr, "Error opening output file: '%s'\n", o.outPath);
+        return 1;
+    }
+    fprintf(f, "# %llu puzzles: %s, %d jumps to (%d, %d)\n", static_cast<unsigned long long>(o.count), o.layout.name.c_str(), o.jumps, o.targetRow, o.targetCol);
+    int status;
+    if (o.layout.numCells() > PegEngine::MAX_CELLS) {
+        PuzzleGenerator<WidePegEngine> gen(o, f);
+        status = gen.run();
+    }
+    else {
+        PuzzleGenerator<PegEngine> gen(o, f);
+        status = gen.run();
+    }
+    return fclose(f) == 0 ? status : 1;
+}